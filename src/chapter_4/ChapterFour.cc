@@ -1,8 +1,13 @@
 #include <vector>
+#include <limits>
+#include <random>
 #include <iostream>
 #include <algorithm>
 #include <cstddef>
 
+#include "RadixSort.h"
+#include "ExternalSort.h"
+
 /* Exercise 4.1 */
 int Sum(const std::vector<int>& values, int low, int high)
 {
@@ -96,5 +101,33 @@ int main(void)
     std::cout << "Search for 4 yields index = "
               << BinarySearch(values, 4, 0, values.size() - 1) << std::endl;
 
+    /* Integer keys take the radix sort fast path. */
+    std::vector<int> keys = {42, -7, 0, 13, -128, 99, 5, -7};
+    RadixSort(keys);
+    std::cout << "Radix Sorted Keys = { ";
+    for (const int& i : keys)
+        std::cout << i << ' ';
+    std::cout << "}" << std::endl;
+
+    /* Give the external sort a tiny memory budget so that it has to spill
+       sorted runs to disk and merge them. */
+    ExternalSortOptions options;
+    options.memory_budget = 64 << 10;
+    ExternalSorter<int> sorter(options);
+
+    std::mt19937 rng(4);
+    for (int i = 0; i < 100000; ++i)
+        sorter.Push(static_cast<int>(rng()));
+
+    bool sorted = sorter.Finish();
+    int  prev   = std::numeric_limits<int>::min();
+    for (const int& value : sorter) {
+        sorted = sorted && (prev <= value);
+        prev   = value;
+    }
+    std::cout << "External Sort Runs = " << sorter.RunCount()
+              << ", Sorted = " << std::boolalpha
+              << (sorted && !sorter.Failed()) << std::endl;
+
     return 0;
 }
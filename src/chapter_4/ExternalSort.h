@@ -0,0 +1,695 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <future>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <type_traits>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "RadixSort.h"
+
+/*!
+ * \struct ExternalSortOptions
+ * \brief The ExternalSortOptions struct configures an ExternalSorter.
+ */
+struct ExternalSortOptions
+{
+    /*! Bytes of RAM used for sorting runs and merge buffers. */
+    std::size_t   memory_budget = 64 << 20;
+    /*! Directory for temporary run files, the system default when empty. */
+    std::string   temp_dir;
+    /*! Maximum bytes of temporary files, unlimited when 0. */
+    std::uint64_t temp_budget = 0;
+};
+
+/*!
+ * \class ExternalSorter
+ * \brief The ExternalSorter class sorts data sets larger than memory.
+ *
+ * Values are pushed one at a time into a buffer holding a share of the
+ * memory budget. Whenever the buffer fills, it is handed to a background
+ * task that sorts it and writes it out as a run while the caller fills
+ * another buffer. Runs of arithmetic values in ascending order are sorted
+ * with RadixSort(), everything else with std::sort(). Finish() keeps the
+ * last run in memory and k-way merges it with the runs on disk through a
+ * loser tree, reading each run sequentially in large blocks. If there are
+ * too many runs to give each a reasonable read buffer, groups of runs are
+ * first merged into longer runs. The merged output is streamed through
+ * begin() and end() without ever being materialized.
+ *
+ * \a T must be trivially copyable since runs are stored as raw bytes. All
+ * functions report I/O failures and exhaustion of the temporary file budget
+ * by returning \c false, after which Failed() stays \c true.
+ */
+template <typename T, typename Compare = std::less<T>>
+class ExternalSorter
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "ExternalSorter requires trivially copyable values");
+
+public:
+    /*!
+     * \class Iterator
+     * \brief Single pass iterator over the merged output.
+     */
+    class Iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const T*;
+        using reference         = const T&;
+
+        Iterator() = default;
+
+        reference
+        operator*() const { return sorter_->Top(); }
+
+        pointer
+        operator->() const { return &sorter_->Top(); }
+
+        Iterator&
+        operator++()
+        {
+            if (!sorter_->Pop())
+                sorter_ = nullptr;
+            return *this;
+        }
+
+        bool
+        operator==(const Iterator& other) const
+            { return (sorter_ == other.sorter_); }
+
+        bool
+        operator!=(const Iterator& other) const
+            { return (sorter_ != other.sorter_); }
+
+    private:
+        friend class ExternalSorter;
+
+        explicit Iterator(ExternalSorter* sorter) :
+            sorter_(sorter->HasTop() ? sorter : nullptr) { }
+
+        ExternalSorter* sorter_ = nullptr; /*!< Null at the end. */
+    }; // end Iterator
+
+    explicit ExternalSorter(const ExternalSortOptions& options={},
+                            Compare comp=Compare());
+
+    ~ExternalSorter();
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+    ExternalSorter(ExternalSorter&&) = delete;
+    ExternalSorter& operator=(ExternalSorter&&) = delete;
+
+    /*!
+     * \brief Add \a value to the data set.
+     *
+     * Push() must not be called after Finish().
+     */
+    bool
+    Push(const T& value);
+
+    /*!
+     * \brief Add every value in [\a first, \a last) to the data set.
+     */
+    template <typename InputIt>
+    bool
+    Push(InputIt first, InputIt last);
+
+    /*!
+     * \brief Complete run generation and prepare the merged output.
+     */
+    bool
+    Finish();
+
+    /*!
+     * \brief Return \c true if an I/O error or the temporary file budget
+     *        stopped the sort.
+     */
+    bool
+    Failed() const { return failed_; }
+
+    /*!
+     * \brief Return the number of runs written to disk so far.
+     */
+    std::size_t
+    RunCount() const { return run_count_; }
+
+    /*!
+     * \brief Return an iterator to the smallest value.
+     *
+     * begin() must only be called once, after Finish(). Iteration stops
+     * early if a read fails.
+     */
+    Iterator
+    begin() { return Iterator(this); }
+
+    Iterator
+    end() { return Iterator(); }
+
+private:
+    /*!
+     * \brief A sorted run stored in an anonymous temporary file.
+     */
+    struct Run
+    {
+        int           fd    = -1; /*!< Unlinked temporary file. */
+        std::uint64_t count = 0;  /*!< Number of values in the run. */
+    };
+
+    /*!
+     * \brief Buffered sequential reader over one run.
+     */
+    struct Source
+    {
+        int            fd        = -1;      /*!< Run file, -1 in memory. */
+        std::uint64_t  offset    = 0;       /*!< Next file byte to read. */
+        std::uint64_t  remaining = 0;       /*!< Values left on disk. */
+        std::vector<T> buffer;              /*!< Read buffer. */
+        const T*       data      = nullptr; /*!< Current block. */
+        std::size_t    size      = 0;       /*!< Values in the block. */
+        std::size_t    pos       = 0;       /*!< Head of the block. */
+
+        bool
+        Exhausted() const { return (pos == size); }
+
+        const T&
+        Head() const { return data[pos]; }
+    };
+
+    /*! Runs are radix sorted, which needs a scratch copy of the run. */
+    static constexpr bool kRadixRuns =
+        std::is_arithmetic<T>::value &&
+        std::is_same<Compare, std::less<T>>::value;
+
+    /*! Smallest read buffer worth giving a run during a merge. */
+    static const std::size_t kMinReadBytes = 1 << 20;
+
+    /*!
+     * \brief Write \a bytes bytes at \a data to \a fd.
+     */
+    static bool
+    WriteAll(int fd, const void* data, std::size_t bytes);
+
+    /*!
+     * \brief Load the next block of \a source from disk.
+     */
+    bool
+    Refill(Source& source);
+
+    /*!
+     * \brief Create a run file in the temporary directory.
+     * \return The file descriptor or -1 on failure.
+     */
+    int
+    CreateRunFile();
+
+    /*!
+     * \brief Close \a run's file and release its temporary file budget.
+     */
+    void
+    CloseRun(Run& run);
+
+    /*!
+     * \brief Reserve \a bytes of the temporary file budget.
+     */
+    bool
+    ReserveTempBytes(std::uint64_t bytes);
+
+    /*!
+     * \brief Sort the values of a single run in memory.
+     */
+    void
+    SortRun(std::vector<T>& run) const;
+
+    /*!
+     * \brief Sort and write the full buffer in the background.
+     */
+    bool
+    FlushBuffer();
+
+    /*!
+     * \brief Wait for the background run writer to finish.
+     */
+    bool
+    WaitForWriter();
+
+    /*!
+     * \brief Set up sources_ over \a runs with \a read_bytes per run.
+     */
+    bool
+    OpenSources(const std::vector<Run>& runs, std::size_t read_bytes);
+
+    /*!
+     * \brief Merge \a runs into a single new run.
+     */
+    bool
+    MergeRuns(const std::vector<Run>& runs, Run& merged);
+
+    /*!
+     * \brief Return \c true if source \a lhs must be emitted before \a rhs.
+     *
+     * Exhausted sources sort last and ties go to the lower source index.
+     */
+    bool
+    Before(std::size_t lhs, std::size_t rhs) const;
+
+    /*!
+     * \brief Build the loser tree over sources_.
+     */
+    void
+    BuildTree();
+
+    /*!
+     * \brief Return the winner of the subtree rooted at \a node.
+     */
+    std::size_t
+    BuildSubtree(std::size_t node);
+
+    /*!
+     * \brief Return \c true if the merge has a value left to emit.
+     */
+    bool
+    HasTop() const
+    {
+        return !failed_ && !tree_.empty() &&
+               !sources_[tree_[0]].Exhausted();
+    }
+
+    /*!
+     * \brief Return the smallest value left in the merge.
+     */
+    const T&
+    Top() const { return sources_[tree_[0]].Head(); }
+
+    /*!
+     * \brief Remove the smallest value from the merge.
+     * \return \c true if the merge has a value left to emit.
+     */
+    bool
+    Pop();
+
+    ExternalSortOptions options_;   /*!< Sorter configuration. */
+    Compare             comp_;      /*!< Value ordering. */
+    std::size_t         run_size_;  /*!< Values per in-memory run. */
+    std::vector<T>      buffer_;    /*!< Run being filled. */
+    std::vector<T>      flushing_;  /*!< Run being written. */
+    std::future<bool>   writer_;    /*!< Background run writer. */
+    std::vector<Run>    runs_;      /*!< Runs on disk. */
+    std::size_t         run_count_; /*!< Total runs written. */
+    std::uint64_t       temp_used_; /*!< Temporary file bytes in use. */
+    std::vector<Source> sources_;   /*!< Runs being merged. */
+    std::vector<std::size_t> tree_; /*!< Loser tree, tree_[0] is the winner. */
+    bool                finished_;  /*!< Finish() has been called. */
+    bool                failed_;    /*!< An operation failed. */
+}; // end ExternalSorter
+
+template <typename T, typename Compare>
+ExternalSorter<T, Compare>::ExternalSorter(const ExternalSortOptions& options,
+                                           Compare comp) :
+    options_(options),
+    comp_(comp),
+    run_count_(0),
+    temp_used_(0),
+    finished_(false),
+    failed_(false)
+{
+    if (options_.temp_dir.empty())
+        options_.temp_dir = std::filesystem::temp_directory_path().string();
+
+    /* One run fills while the other is written. A radix sorted run also
+       needs a scratch run while it is sorted. */
+    std::size_t run_buffers = kRadixRuns ? 3 : 2;
+    run_size_ = std::max<std::size_t>(
+        1024, options_.memory_budget / run_buffers / sizeof(T));
+    buffer_.reserve(run_size_);
+}
+
+template <typename T, typename Compare>
+ExternalSorter<T, Compare>::~ExternalSorter()
+{
+    if (writer_.valid())
+        writer_.wait();
+    for (Run& run : runs_)
+        CloseRun(run);
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::WriteAll(int fd, const void* data,
+                                     std::size_t bytes)
+{
+    const char* curr = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t written = ::write(fd, curr, bytes);
+        if (written < 0) {
+            if (EINTR == errno)
+                continue;
+            return false;
+        }
+        curr  += written;
+        bytes -= written;
+    }
+    return true;
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::Refill(Source& source)
+{
+    std::size_t count = static_cast<std::size_t>(
+        std::min<std::uint64_t>(source.remaining, source.buffer.size()));
+    char*       curr  = reinterpret_cast<char*>(source.buffer.data());
+    std::size_t bytes = count * sizeof(T);
+    while (bytes > 0) {
+        ssize_t got = ::pread(source.fd, curr, bytes, source.offset);
+        if ((got < 0) && (EINTR == errno))
+            continue;
+        if (got <= 0) {
+            failed_ = true;
+            return false;
+        }
+        curr          += got;
+        bytes         -= got;
+        source.offset += got;
+    }
+
+    source.remaining -= count;
+    source.data       = source.buffer.data();
+    source.size       = count;
+    source.pos        = 0;
+
+    return true;
+}
+
+template <typename T, typename Compare>
+int
+ExternalSorter<T, Compare>::CreateRunFile()
+{
+    std::string path = options_.temp_dir + "/ga_sort_XXXXXX";
+    int fd = ::mkstemp(&path[0]);
+    if (fd < 0)
+        return -1;
+
+    /* Unlink right away so the file disappears once it is closed, even if
+       the process dies. */
+    ::unlink(path.c_str());
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    return fd;
+}
+
+template <typename T, typename Compare>
+void
+ExternalSorter<T, Compare>::CloseRun(Run& run)
+{
+    if (run.fd < 0)
+        return;
+
+    ::close(run.fd);
+    temp_used_ -= run.count * sizeof(T);
+    run.fd      = -1;
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::ReserveTempBytes(std::uint64_t bytes)
+{
+    if ((options_.temp_budget > 0) &&
+        (temp_used_ + bytes > options_.temp_budget)) {
+        failed_ = true;
+        return false;
+    }
+
+    temp_used_ += bytes;
+    return true;
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::WaitForWriter()
+{
+    if (writer_.valid() && !writer_.get())
+        failed_ = true;
+
+    return !failed_;
+}
+
+template <typename T, typename Compare>
+void
+ExternalSorter<T, Compare>::SortRun(std::vector<T>& run) const
+{
+    if constexpr (kRadixRuns)
+        RadixSort(run);
+    else
+        std::sort(run.begin(), run.end(), comp_);
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::FlushBuffer()
+{
+    /* Only one run is written at a time, the previous one must be done
+       before its buffer can be reused. */
+    if (!WaitForWriter())
+        return false;
+
+    Run run;
+    run.count = buffer_.size();
+    if (!ReserveTempBytes(run.count * sizeof(T)))
+        return false;
+
+    run.fd = CreateRunFile();
+    runs_.push_back(run);
+    run_count_++;
+    if (run.fd < 0) {
+        failed_ = true;
+        return false;
+    }
+
+    std::swap(buffer_, flushing_);
+    buffer_.clear();
+    buffer_.reserve(run_size_);
+
+    int fd = run.fd;
+    writer_ = std::async(std::launch::async, [this, fd]() {
+        SortRun(flushing_);
+        return WriteAll(fd, flushing_.data(), flushing_.size() * sizeof(T));
+    });
+
+    return true;
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::Push(const T& value)
+{
+    if (failed_)
+        return false;
+
+    buffer_.push_back(value);
+    if (buffer_.size() >= run_size_)
+        return FlushBuffer();
+
+    return true;
+}
+
+template <typename T, typename Compare>
+template <typename InputIt>
+bool
+ExternalSorter<T, Compare>::Push(InputIt first, InputIt last)
+{
+    for (; first != last; ++first) {
+        if (!Push(*first))
+            return false;
+    }
+    return true;
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::Before(std::size_t lhs, std::size_t rhs) const
+{
+    const Source& left  = sources_[lhs];
+    const Source& right = sources_[rhs];
+    if (left.Exhausted())
+        return false;
+    if (right.Exhausted())
+        return true;
+    if (comp_(left.Head(), right.Head()))
+        return true;
+    if (comp_(right.Head(), left.Head()))
+        return false;
+    return (lhs < rhs);
+}
+
+template <typename T, typename Compare>
+std::size_t
+ExternalSorter<T, Compare>::BuildSubtree(std::size_t node)
+{
+    /* Leaves occupy positions [k, 2k) of the implicit tree. */
+    std::size_t k = sources_.size();
+    if (node >= k)
+        return node - k;
+
+    std::size_t left  = BuildSubtree(2 * node);
+    std::size_t right = BuildSubtree(2 * node + 1);
+    if (Before(left, right)) {
+        tree_[node] = right;
+        return left;
+    }
+    tree_[node] = left;
+    return right;
+}
+
+template <typename T, typename Compare>
+void
+ExternalSorter<T, Compare>::BuildTree()
+{
+    tree_.assign(std::max<std::size_t>(1, sources_.size()), 0);
+    if (sources_.size() > 1)
+        tree_[0] = BuildSubtree(1);
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::Pop()
+{
+    std::size_t winner = tree_[0];
+    Source&     source = sources_[winner];
+
+    source.pos++;
+    if (source.Exhausted() && (source.remaining > 0) && !Refill(source))
+        return false;
+
+    /* Replay the matches on the path from the winner's leaf to the root,
+       each node keeps the loser and passes the winner up. */
+    std::size_t k = sources_.size();
+    for (std::size_t node = (winner + k) / 2; node > 0; node /= 2) {
+        if (Before(tree_[node], winner))
+            std::swap(tree_[node], winner);
+    }
+    tree_[0] = winner;
+
+    return HasTop();
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::OpenSources(const std::vector<Run>& runs,
+                                        std::size_t read_bytes)
+{
+    std::size_t read_size = std::max<std::size_t>(1, read_bytes / sizeof(T));
+    for (const Run& run : runs) {
+        Source source;
+        source.fd        = run.fd;
+        source.remaining = run.count;
+        source.buffer.resize(read_size);
+        sources_.push_back(std::move(source));
+        if ((sources_.back().remaining > 0) && !Refill(sources_.back()))
+            return false;
+    }
+    return true;
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::MergeRuns(const std::vector<Run>& runs,
+                                      Run& merged)
+{
+    for (const Run& run : runs)
+        merged.count += run.count;
+    if (!ReserveTempBytes(merged.count * sizeof(T)))
+        return false;
+
+    merged.fd = CreateRunFile();
+    if (merged.fd < 0) {
+        failed_ = true;
+        return false;
+    }
+
+    /* Split the half of the budget not held by the last run between one
+       read buffer per run and the output. */
+    std::size_t block_bytes = options_.memory_budget / 2 / (runs.size() + 1);
+    sources_.clear();
+    if (!OpenSources(runs, block_bytes))
+        return false;
+    BuildTree();
+
+    std::vector<T> output;
+    output.reserve(std::max<std::size_t>(1, block_bytes / sizeof(T)));
+    bool more = HasTop();
+    while (more) {
+        output.push_back(Top());
+        more = Pop();
+        if ((output.size() == output.capacity()) || !more) {
+            if (!WriteAll(merged.fd, output.data(),
+                          output.size() * sizeof(T))) {
+                failed_ = true;
+                return false;
+            }
+            output.clear();
+        }
+    }
+    sources_.clear();
+
+    return !failed_;
+}
+
+template <typename T, typename Compare>
+bool
+ExternalSorter<T, Compare>::Finish()
+{
+    if (finished_ || !WaitForWriter())
+        return false;
+    finished_ = true;
+
+    /* The write buffer is no longer needed, give its memory to the merge. */
+    std::vector<T>().swap(flushing_);
+
+    /* Merge groups of runs until every run gets a large enough read buffer
+       out of the budget left after the last run, which stays in memory. */
+    std::size_t fan_in = std::max<std::size_t>(
+        2, options_.memory_budget / 2 / kMinReadBytes);
+    while (runs_.size() > fan_in) {
+        std::vector<Run> group(runs_.begin(), runs_.begin() + fan_in);
+        runs_.erase(runs_.begin(), runs_.begin() + fan_in);
+
+        Run merged;
+        bool ok = MergeRuns(group, merged);
+        for (Run& run : group)
+            CloseRun(run);
+        runs_.push_back(merged);
+        if (!ok)
+            return false;
+    }
+
+    sources_.clear();
+    std::size_t read_bytes =
+        options_.memory_budget / 2 / std::max<std::size_t>(1, runs_.size());
+    if (!OpenSources(runs_, read_bytes))
+        return false;
+
+    /* The final, partial run never touches the disk. */
+    SortRun(buffer_);
+    Source in_memory;
+    in_memory.data = buffer_.data();
+    in_memory.size = buffer_.size();
+    sources_.push_back(std::move(in_memory));
+
+    BuildTree();
+
+    return true;
+}
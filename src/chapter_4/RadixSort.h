@@ -0,0 +1,306 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+
+/*!
+ * \struct RadixTraits
+ * \brief The RadixTraits struct maps a value to an unsigned radix key.
+ *
+ * The key of every radix sortable value is an unsigned integer whose natural
+ * order matches the value's order. Types without a specialization are not
+ * radix sortable.
+ */
+template <typename T, typename Enable = void>
+struct RadixTraits
+{
+    static constexpr bool kSortable = false; /*!< Not radix sortable. */
+};
+
+/*!
+ * \brief Unsigned integer type with the same width as \a T.
+ */
+template <typename T>
+using RadixKey = std::conditional_t<sizeof(T) == 1, std::uint8_t,
+                 std::conditional_t<sizeof(T) == 2, std::uint16_t,
+                 std::conditional_t<sizeof(T) == 4, std::uint32_t,
+                                                    std::uint64_t>>>;
+
+/*!
+ * \struct RadixTraits
+ * \brief Integers order by their bits once the sign bit is flipped.
+ */
+template <typename T>
+struct RadixTraits<T, std::enable_if_t<std::is_integral<T>::value &&
+                                       !std::is_same<T, bool>::value &&
+                                       (sizeof(T) <= 8)>>
+{
+    static constexpr bool kSortable = true;
+    using Key = RadixKey<T>;
+
+    static Key
+    ToKey(const T& value)
+    {
+        Key key = static_cast<Key>(value);
+        if constexpr (std::is_signed<T>::value)
+            key ^= static_cast<Key>(Key(1) << (sizeof(Key) * 8 - 1));
+        return key;
+    }
+};
+
+/*!
+ * \struct RadixTraits
+ * \brief IEEE 754 values order by their bits once negative values have all
+ *        bits flipped and positive values have the sign bit flipped.
+ *
+ * -0.0 sorts before 0.0 and NaNs sort to the ends according to their sign.
+ */
+template <typename T>
+struct RadixTraits<T, std::enable_if_t<std::is_floating_point<T>::value &&
+                                       ((sizeof(T) == 4) || (sizeof(T) == 8))>>
+{
+    static constexpr bool kSortable = true;
+    using Key = RadixKey<T>;
+
+    static Key
+    ToKey(const T& value)
+    {
+        Key key;
+        std::memcpy(&key, &value, sizeof(key));
+        Key sign = key >> (sizeof(Key) * 8 - 1);
+        Key mask = static_cast<Key>(-sign) |
+                   static_cast<Key>(Key(1) << (sizeof(Key) * 8 - 1));
+        return key ^ mask;
+    }
+};
+
+/*!
+ * \struct RadixTraits
+ * \brief Key/value pairs are ordered by their key alone.
+ */
+template <typename K, typename V>
+struct RadixTraits<std::pair<K, V>,
+                   std::enable_if_t<RadixTraits<K>::kSortable>>
+{
+    static constexpr bool kSortable = true;
+    using Key = typename RadixTraits<K>::Key;
+
+    static Key
+    ToKey(const std::pair<K, V>& value)
+        { return RadixTraits<K>::ToKey(value.first); }
+};
+
+/*! Below this many values a comparison sort beats the radix passes. */
+static const std::size_t kMinRadixSortSize = 256;
+
+/*! Values per write combining buffer, roughly one cache line. */
+template <typename T>
+constexpr std::size_t kRadixLineSize =
+    (sizeof(T) >= 64) ? 1 : (64 / sizeof(T));
+
+using RadixCounts = std::array<std::size_t, 256>;
+
+/*!
+ * \brief Return byte \a digit of \a value's radix key.
+ */
+template <typename T>
+inline std::size_t
+RadixDigit(const T& value, std::size_t digit)
+{
+    return (RadixTraits<T>::ToKey(value) >> (digit * 8)) & 0xFF;
+}
+
+/*!
+ * \brief Add the byte histograms of every digit of [\a first, \a last) to
+ *        \a counts in a single pass.
+ */
+template <typename T, std::size_t kDigits>
+void
+RadixHistogram(const T* first, const T* last,
+               std::array<RadixCounts, kDigits>& counts)
+{
+    for (; first != last; ++first) {
+        auto key = RadixTraits<T>::ToKey(*first);
+        for (std::size_t d = 0; d < kDigits; ++d)
+            counts[d][(key >> (d * 8)) & 0xFF]++;
+    }
+}
+
+/*!
+ * \brief Stable scatter of [\a first, \a last) into \a dst by \a digit.
+ *
+ * \a offsets holds the next free position of each bucket in \a dst and is
+ * advanced past the written values. Values are staged in a cache line sized
+ * buffer per bucket and copied out one full line at a time, so the scatter
+ * touches 256 buffers that stay in cache instead of 256 arbitrary lines of
+ * \a dst for every value.
+ */
+template <typename T>
+void
+RadixScatter(const T* first, const T* last, T* dst, std::size_t digit,
+             RadixCounts& offsets)
+{
+    constexpr std::size_t kLine = kRadixLineSize<T>;
+
+    std::vector<T> lines(256 * kLine);
+    RadixCounts    fill = {};
+    for (; first != last; ++first) {
+        std::size_t bucket = RadixDigit(*first, digit);
+        T*          line   = &lines[bucket * kLine];
+        line[fill[bucket]++] = *first;
+        if (kLine == fill[bucket]) {
+            std::copy(line, line + kLine, dst + offsets[bucket]);
+            offsets[bucket] += kLine;
+            fill[bucket]     = 0;
+        }
+    }
+
+    /* Drain the partially filled lines. */
+    for (std::size_t bucket = 0; bucket < 256; ++bucket) {
+        const T* line = &lines[bucket * kLine];
+        std::copy(line, line + fill[bucket], dst + offsets[bucket]);
+        offsets[bucket] += fill[bucket];
+    }
+}
+
+/*!
+ * \brief Sort \a values with a comparison sort consistent with RadixSort().
+ */
+template <typename T>
+void
+RadixFallbackSort(std::vector<T>& values)
+{
+    if constexpr (RadixTraits<T>::kSortable) {
+        /* Order by radix key so small inputs sort exactly like large ones,
+           including stable ordering of pairs with equal keys. */
+        std::stable_sort(values.begin(), values.end(),
+            [](const T& lhs, const T& rhs)
+                { return RadixTraits<T>::ToKey(lhs) <
+                         RadixTraits<T>::ToKey(rhs); });
+    } else {
+        std::sort(values.begin(), values.end());
+    }
+}
+
+/*!
+ * \brief Sort \a values in ascending order using up to \a num_threads
+ *        threads.
+ *
+ * Integers, floating point values and std::pair key/value records with such
+ * keys are sorted with a least significant digit radix sort over 8-bit
+ * digits. The byte histograms for every digit are gathered in one pass and
+ * digits on which all values agree are skipped. Each thread scatters its own
+ * slice of the input into the positions reserved for it by a prefix sum over
+ * the per-thread histograms. Pairs are ordered by key only, and values with
+ * equal keys keep their relative order.
+ *
+ * Every other type falls back to a comparison sort.
+ */
+template <typename T>
+void
+ParallelRadixSort(std::vector<T>& values,
+                  std::size_t num_threads=std::thread::hardware_concurrency())
+{
+    if constexpr (!RadixTraits<T>::kSortable) {
+        RadixFallbackSort(values);
+    } else {
+        constexpr std::size_t kDigits = sizeof(typename RadixTraits<T>::Key);
+
+        std::size_t size = values.size();
+        if (size < kMinRadixSortSize) {
+            RadixFallbackSort(values);
+            return;
+        }
+
+        /* Threads are not worth starting for fewer than 16K values each. */
+        num_threads = std::max<std::size_t>(1, std::min(num_threads,
+                                                        size / (1 << 14)));
+
+        std::vector<std::size_t> bounds;
+        for (std::size_t t = 0; t <= num_threads; ++t)
+            bounds.push_back((size * t) / num_threads);
+
+        /* Runs fn(t) for every thread slice t and waits for all of them. */
+        auto for_each_slice = [num_threads](auto fn) {
+            std::vector<std::thread> workers;
+            for (std::size_t t = 1; t < num_threads; ++t)
+                workers.emplace_back(fn, t);
+            fn(0);
+            for (std::thread& worker : workers)
+                worker.join();
+        };
+
+        std::vector<T> buffer(size);
+        T* src = values.data();
+        T* dst = buffer.data();
+
+        /* Per-thread histograms of every digit, gathered in a single pass. */
+        std::vector<std::array<RadixCounts, kDigits>> counts(num_threads);
+        for_each_slice([&](std::size_t t) {
+            counts[t] = {};
+            RadixHistogram(src + bounds[t], src + bounds[t + 1], counts[t]);
+        });
+
+        std::vector<RadixCounts> offsets(num_threads);
+        bool                     scattered = false;
+        for (std::size_t digit = 0; digit < kDigits; ++digit) {
+            /* Skip the digit if every value falls into the same bucket. */
+            RadixCounts total = {};
+            for (std::size_t t = 0; t < num_threads; ++t) {
+                for (std::size_t b = 0; b < 256; ++b)
+                    total[b] += counts[t][digit][b];
+            }
+            if (std::find(total.cbegin(), total.cend(), size) != total.cend())
+                continue;
+
+            /* After the first scatter, values have moved between slices so
+               the per-thread counts of this digit must be recomputed. */
+            if ((num_threads > 1) && scattered) {
+                for_each_slice([&](std::size_t t) {
+                    counts[t][digit] = {};
+                    for (std::size_t i = bounds[t]; i < bounds[t + 1]; ++i)
+                        counts[t][digit][RadixDigit(src[i], digit)]++;
+                });
+            }
+
+            /* Bucket b of thread t starts after all smaller buckets and
+               after bucket b of every earlier thread. */
+            std::size_t next = 0;
+            for (std::size_t b = 0; b < 256; ++b) {
+                for (std::size_t t = 0; t < num_threads; ++t) {
+                    offsets[t][b] = next;
+                    next         += counts[t][digit][b];
+                }
+            }
+
+            for_each_slice([&](std::size_t t) {
+                RadixScatter(src + bounds[t], src + bounds[t + 1], dst, digit,
+                             offsets[t]);
+            });
+            std::swap(src, dst);
+            scattered = true;
+        }
+
+        if (src != values.data())
+            values.swap(buffer);
+    }
+}
+
+/*!
+ * \brief Sort \a values in ascending order on the calling thread.
+ *
+ * \see ParallelRadixSort()
+ */
+template <typename T>
+void
+RadixSort(std::vector<T>& values)
+{
+    ParallelRadixSort(values, 1);
+}
@@ -0,0 +1,503 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <optional>
+#include <exception>
+#include <functional>
+#include <shared_mutex>
+#include <cstdint>
+#include <cstddef>
+
+#include "Map.h"
+
+/*!
+ * \struct CacheStats
+ * \brief The CacheStats struct holds a snapshot of a Cache's counters.
+ */
+struct CacheStats
+{
+    std::uint64_t hits      = 0; /*!< Lookups served from the cache. */
+    std::uint64_t misses    = 0; /*!< Lookups that found no entry. */
+    std::uint64_t coalesced = 0; /*!< Misses that waited on another thread. */
+    std::uint64_t evictions = 0; /*!< Entries evicted to make room. */
+
+    /*!
+     * \brief Return the fraction of lookups served from the cache.
+     */
+    double
+    HitRate() const
+    {
+        std::uint64_t lookups = hits + misses + coalesced;
+        return (0 == lookups) ? 0.0 : static_cast<double>(hits) / lookups;
+    }
+};
+
+/*!
+ * \class Cache
+ * \brief The Cache class implements a bounded, thread safe CLOCK cache.
+ *
+ * Keys are spread over independently locked shards. Each shard indexes its
+ * entries with a Map and evicts with the CLOCK algorithm: a hit only sets
+ * the entry's reference bit, so lookups hold the shard lock in shared mode
+ * and never contend with each other. Insertions take the shard lock
+ * exclusively and sweep the clock hand over the shard's slots, evicting the
+ * first entry whose reference bit is clear.
+ *
+ * The capacity is a budget in units chosen by the Weigher. By default every
+ * entry weighs 1 so the capacity is an entry count. A Weigher returning an
+ * entry's size in bytes turns the capacity into a memory budget.
+ *
+ * Each shard owns an equal part of the capacity, and an entry must fit in
+ * the budget of its own shard. The constructor therefore uses fewer shards
+ * when the capacity is too small to give every shard room for an entry of
+ * weight \a max_charge.
+ */
+template <typename Key, typename Value>
+class Cache
+{
+public:
+    using Weigher = std::function<std::size_t(const Key&, const Value&)>;
+
+    /*!
+     * \brief Construct a Cache.
+     *
+     * Entries weighing up to \a max_charge can always be cached. Heavier
+     * entries are cached only if they fit in the budget of their shard, so
+     * pass \a capacity as \a max_charge to accept every entry that fits in
+     * the cache at the cost of a single shard.
+     *
+     * \param capacity   Total budget shared evenly by the shards.
+     * \param weigher    Returns the budget an entry consumes, 1 when empty.
+     * \param num_shards Largest number of independently locked shards.
+     * \param max_charge Weight every shard must be able to hold.
+     */
+    explicit Cache(std::size_t capacity,
+                   Weigher weigher=nullptr,
+                   std::size_t num_shards=kDefaultShardCount,
+                   std::size_t max_charge=1);
+
+    ~Cache() = default;
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+    Cache(Cache&&) = delete;
+    Cache& operator=(Cache&&) = delete;
+
+    /*!
+     * \brief Return the total budget of the cache.
+     */
+    std::size_t
+    Capacity() const { return capacity_; }
+
+    /*!
+     * \brief Return the number of cached entries.
+     */
+    std::size_t
+    Size() const;
+
+    /*!
+     * \brief Return a copy of the value cached under \a key.
+     * \return The cached value or std::nullopt if \a key is not cached.
+     */
+    std::optional<Value>
+    Get(const Key& key);
+
+    /*!
+     * \brief Cache \a value under \a key, replacing any existing entry.
+     *
+     * Entries heavier than their shard's budget are not cached.
+     *
+     * \see Cache()
+     */
+    void
+    Put(const Key& key, const Value& value);
+
+    /*!
+     * \brief Return \c true if \a key was cached and its entry is deleted.
+     */
+    bool
+    Erase(const Key& key);
+
+    /*!
+     * \brief Return the value cached under \a key, computing it on a miss.
+     *
+     * On a miss \a compute(key) is called and its result is cached. If
+     * several threads miss on the same key at once, only one of them calls
+     * \a compute and the others wait for its result. An exception thrown by
+     * \a compute propagates to every waiting thread and nothing is cached.
+     * A Put() or Erase() of \a key made while \a compute runs wins: the
+     * computed value is still returned to the waiting threads but is not
+     * cached.
+     */
+    template <typename Compute>
+    Value
+    GetOrCompute(const Key& key, Compute compute);
+
+    /*!
+     * \brief Return the hit, miss and eviction counters.
+     */
+    CacheStats
+    GetStats() const;
+
+private:
+    static const std::size_t
+    kDefaultShardCount = 16; /*!< Default number of shards. */
+
+    /*!
+     * \brief Storage for one cached entry.
+     */
+    struct Slot
+    {
+        std::optional<std::pair<Key, Value>> entry;             /*!< Entry. */
+        std::size_t                          charge = 0;        /*!< Weight. */
+        std::atomic<bool>                    referenced{false}; /*!< CLOCK. */
+    };
+
+    /*!
+     * \brief An in-flight GetOrCompute() call.
+     */
+    struct Pending
+    {
+        std::shared_future<Value> result; /*!< Computed value. */
+        std::uint64_t             ticket; /*!< Identifies the computation. */
+    };
+
+    /*!
+     * \brief An independently locked partition of the cache.
+     */
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mutex;       /*!< Guards everything below. */
+        Map<Key, std::size_t>     index;       /*!< Key to slot position. */
+        std::deque<Slot>          slots;       /*!< Clock face. */
+        std::vector<std::size_t>  free_slots;  /*!< Vacant slot positions. */
+        std::size_t               hand   = 0;  /*!< Clock hand position. */
+        std::size_t               used   = 0;  /*!< Budget in use. */
+        std::size_t               budget = 0;  /*!< Budget limit. */
+        Map<Key, Pending>         pending;     /*!< In-flight computations. */
+        std::uint64_t             tickets = 0; /*!< Computations started. */
+
+        std::atomic<std::uint64_t> hits{0};      /*!< See CacheStats. */
+        std::atomic<std::uint64_t> misses{0};    /*!< See CacheStats. */
+        std::atomic<std::uint64_t> coalesced{0}; /*!< See CacheStats. */
+        std::atomic<std::uint64_t> evictions{0}; /*!< See CacheStats. */
+    };
+
+    /*!
+     * \brief Return the shard responsible for \a key.
+     */
+    Shard&
+    GetShard(const Key& key) const;
+
+    /*!
+     * \brief Return the entry's value and mark it referenced.
+     *
+     * The caller must hold \a shard's lock in either mode.
+     */
+    std::optional<Value>
+    Lookup(Shard& shard, const Key& key) const;
+
+    /*!
+     * \brief Insert or replace an entry, evicting entries as needed.
+     *
+     * The caller must hold \a shard's lock exclusively.
+     */
+    void
+    InsertLocked(Shard& shard, const Key& key, const Value& value);
+
+    /*!
+     * \brief Remove the entry in slot \a pos.
+     *
+     * The caller must hold \a shard's lock exclusively.
+     */
+    void
+    RemoveLocked(Shard& shard, std::size_t pos);
+
+    /*!
+     * \brief Evict one entry chosen by the CLOCK algorithm.
+     *
+     * The caller must hold \a shard's lock exclusively and \a shard must not
+     * be empty.
+     */
+    void
+    EvictLocked(Shard& shard);
+
+    std::vector<std::unique_ptr<Shard>> shards_;   /*!< Cache partitions. */
+    std::size_t                         capacity_; /*!< Total budget. */
+    Weigher                             weigher_;  /*!< Entry weight. */
+    std::hash<Key>                      hasher_;   /*!< Shard selector. */
+}; // end Cache
+
+template <typename Key, typename Value>
+Cache<Key, Value>::Cache(std::size_t capacity,
+                         Weigher weigher,
+                         std::size_t num_shards,
+                         std::size_t max_charge) :
+    capacity_(capacity),
+    weigher_(std::move(weigher))
+{
+    if (0 == num_shards)
+        num_shards = kDefaultShardCount;
+
+    /* Every shard's budget must be at least max_charge, otherwise keys
+       hashing to a starved shard could never be cached. */
+    std::size_t min_budget = std::max<std::size_t>(1, max_charge);
+    num_shards = std::max<std::size_t>(
+        1, std::min(num_shards, capacity / min_budget));
+
+    /* Spread the budget evenly, giving the remainder to the first shards. */
+    for (std::size_t i = 0; i < num_shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+        shards_.back()->budget =
+            (capacity / num_shards) + ((i < capacity % num_shards) ? 1 : 0);
+    }
+}
+
+template <typename Key, typename Value>
+typename Cache<Key, Value>::Shard&
+Cache<Key, Value>::GetShard(const Key& key) const
+{
+    /* Map uses the low bits of the hash to pick a bucket. Mix the hash and
+       use its high bits for the shard so the two choices are independent. */
+    std::uint64_t mixed =
+        static_cast<std::uint64_t>(hasher_(key)) * 0x9E3779B97F4A7C15ULL;
+    return *shards_[(mixed >> 32) % shards_.size()];
+}
+
+template <typename Key, typename Value>
+std::size_t
+Cache<Key, Value>::Size() const
+{
+    std::size_t size = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        size += shard->index.Size();
+    }
+    return size;
+}
+
+template <typename Key, typename Value>
+std::optional<Value>
+Cache<Key, Value>::Lookup(Shard& shard, const Key& key) const
+{
+    const Map<Key, std::size_t>& index = shard.index;
+    const std::size_t* pos = index.Get(key);
+    if (!pos)
+        return std::nullopt;
+
+    Slot& slot = shard.slots[*pos];
+    if (!slot.referenced.load(std::memory_order_relaxed))
+        slot.referenced.store(true, std::memory_order_relaxed);
+
+    return slot.entry->second;
+}
+
+template <typename Key, typename Value>
+void
+Cache<Key, Value>::RemoveLocked(Shard& shard, std::size_t pos)
+{
+    Slot& slot = shard.slots[pos];
+    shard.index.Erase(slot.entry->first);
+    shard.used -= slot.charge;
+    slot.entry.reset();
+    slot.charge = 0;
+    slot.referenced.store(false, std::memory_order_relaxed);
+    shard.free_slots.push_back(pos);
+}
+
+template <typename Key, typename Value>
+void
+Cache<Key, Value>::EvictLocked(Shard& shard)
+{
+    /* Sweep the hand, giving referenced entries a second chance. The loop
+       ends within two revolutions since every bit it passes is cleared. */
+    while (true) {
+        std::size_t pos = shard.hand;
+        shard.hand = (shard.hand + 1) % shard.slots.size();
+
+        Slot& slot = shard.slots[pos];
+        if (!slot.entry)
+            continue;
+        if (slot.referenced.exchange(false, std::memory_order_relaxed))
+            continue;
+
+        RemoveLocked(shard, pos);
+        shard.evictions.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+}
+
+template <typename Key, typename Value>
+void
+Cache<Key, Value>::InsertLocked(Shard& shard, const Key& key,
+                                const Value& value)
+{
+    /* Drop the old entry first so its budget can be reused. */
+    const std::size_t* existing = shard.index.Get(key);
+    if (existing)
+        RemoveLocked(shard, *existing);
+
+    std::size_t charge = weigher_ ? weigher_(key, value) : 1;
+    if (charge > shard.budget)
+        return;
+
+    while (shard.used + charge > shard.budget)
+        EvictLocked(shard);
+
+    std::size_t pos = 0;
+    if (!shard.free_slots.empty()) {
+        pos = shard.free_slots.back();
+        shard.free_slots.pop_back();
+    } else {
+        pos = shard.slots.size();
+        shard.slots.emplace_back();
+    }
+
+    Slot& slot = shard.slots[pos];
+    slot.entry.emplace(key, value);
+    slot.charge = charge;
+    slot.referenced.store(false, std::memory_order_relaxed);
+    shard.index.Insert(key, pos);
+    shard.used += charge;
+}
+
+template <typename Key, typename Value>
+std::optional<Value>
+Cache<Key, Value>::Get(const Key& key)
+{
+    Shard& shard = GetShard(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    std::optional<Value> value = Lookup(shard, key);
+    if (value)
+        shard.hits.fetch_add(1, std::memory_order_relaxed);
+    else
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+
+    return value;
+}
+
+template <typename Key, typename Value>
+void
+Cache<Key, Value>::Put(const Key& key, const Value& value)
+{
+    Shard& shard = GetShard(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    InsertLocked(shard, key, value);
+
+    /* Supersede any in-flight computation so it cannot overwrite value. */
+    shard.pending.Erase(key);
+}
+
+template <typename Key, typename Value>
+bool
+Cache<Key, Value>::Erase(const Key& key)
+{
+    Shard& shard = GetShard(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+    /* Supersede any in-flight computation so it cannot resurrect key. */
+    shard.pending.Erase(key);
+
+    const std::size_t* pos = shard.index.Get(key);
+    if (!pos)
+        return false;
+
+    RemoveLocked(shard, *pos);
+    return true;
+}
+
+template <typename Key, typename Value>
+template <typename Compute>
+Value
+Cache<Key, Value>::GetOrCompute(const Key& key, Compute compute)
+{
+    Shard& shard = GetShard(key);
+
+    /* Fast path, the entry is cached. */
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        std::optional<Value> value = Lookup(shard, key);
+        if (value) {
+            shard.hits.fetch_add(1, std::memory_order_relaxed);
+            return *value;
+        }
+    }
+
+    /* Slow path. The entry may have been filled or another thread may have
+       started computing it since the shared lock was released. */
+    std::promise<Value>       promise;
+    std::shared_future<Value> result;
+    std::uint64_t             ticket = 0;
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        std::optional<Value> value = Lookup(shard, key);
+        if (value) {
+            shard.hits.fetch_add(1, std::memory_order_relaxed);
+            return *value;
+        }
+
+        const Pending* pending = shard.pending.Get(key);
+        if (pending) {
+            result = pending->result;
+            shard.coalesced.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            ticket = shard.tickets++;
+            shard.pending.Insert(key, Pending{promise.get_future().share(),
+                                              ticket});
+            shard.misses.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /* Wait for the thread that owns the computation. */
+    if (result.valid())
+        return result.get();
+
+    /* Return true if no Put() or Erase() of key superseded the computation.
+       The caller must hold the shard lock. */
+    auto is_current = [&shard, &key, ticket]() {
+        const Pending* pending = shard.pending.Get(key);
+        return pending && (ticket == pending->ticket);
+    };
+
+    try {
+        Value value = compute(key);
+        {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            if (is_current()) {
+                InsertLocked(shard, key, value);
+                shard.pending.Erase(key);
+            }
+        }
+        promise.set_value(value);
+        return value;
+    } catch (...) {
+        {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            if (is_current())
+                shard.pending.Erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+template <typename Key, typename Value>
+CacheStats
+Cache<Key, Value>::GetStats() const
+{
+    CacheStats stats;
+    for (const auto& shard : shards_) {
+        stats.hits      += shard->hits.load(std::memory_order_relaxed);
+        stats.misses    += shard->misses.load(std::memory_order_relaxed);
+        stats.coalesced += shard->coalesced.load(std::memory_order_relaxed);
+        stats.evictions += shard->evictions.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
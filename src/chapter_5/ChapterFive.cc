@@ -1,8 +1,13 @@
 #include <string>
 #include <iostream>
+#include <filesystem>
+#include <cstdio>
 #include <cstdint>
 
+#include <unistd.h>
+
 #include "Map.h"
+#include "MapSnapshot.h"
 
 int main(void)
 {
@@ -24,5 +29,34 @@ int main(void)
     std::cout << "Load Factor After Deletion = "
               << phonebook.LoadFactor() << std::endl;
 
+    /* Persist the phonebook and query it directly from the mapped file.
+       mkstemp() reserves a unique name that the snapshot then replaces. */
+    std::string path =
+        (std::filesystem::temp_directory_path() / "phonebook-XXXXXX").string();
+    int fd = ::mkstemp(path.data());
+    if (fd < 0) {
+        std::cerr << "Failed to create the snapshot file." << std::endl;
+        return 1;
+    }
+    ::close(fd);
+
+    MapSnapshot<std::string, std::uint64_t> snapshot;
+    if (!WriteSnapshot(phonebook, path) || !snapshot.Open(path)) {
+        std::cerr << "Failed to snapshot the phonebook." << std::endl;
+        std::remove(path.c_str());
+        return 1;
+    }
+    std::cout << "Taylor's Number (Snapshot) = " << *snapshot.Get("Taylor")
+              << std::endl;
+
+    /* Thaw the snapshot into a Map that can be modified again. */
+    Map<std::string, std::uint64_t> restored = snapshot.Thaw();
+    restored.Insert("Ivan", 5803418882);
+    std::cout << "Entries After Thaw and Insert = " << restored.Size()
+              << std::endl;
+
+    snapshot.Close();
+    std::remove(path.c_str());
+
     return 0;
 }
@@ -0,0 +1,106 @@
+#include <cmath>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include "Cache.h"
+
+using Clock   = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+static const std::size_t kNumKeys      = 1000000;
+static const std::size_t kCapacity     = kNumKeys / 10;
+static const std::size_t kOpsPerThread = 1000000;
+static const double      kZipfSkew     = 0.99;
+
+/*!
+ * \class ZipfGenerator
+ * \brief Draws keys in [0, n) where key k has probability proportional to
+ *        1 / (k + 1)^skew.
+ */
+class ZipfGenerator
+{
+public:
+    ZipfGenerator(std::size_t n, double skew) : cdf_(n)
+    {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            sum    += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+            cdf_[i] = sum;
+        }
+        for (double& p : cdf_)
+            p /= sum;
+    }
+
+    std::uint64_t
+    operator()(std::mt19937_64& rng) const
+    {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        auto key = std::lower_bound(cdf_.cbegin(), cdf_.cend(), u);
+        return std::min<std::size_t>(key - cdf_.cbegin(), cdf_.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf_; /*!< Cumulative key probabilities. */
+};
+
+/*!
+ * \brief Stand-in for an expensive backend lookup.
+ */
+std::uint64_t Compute(const std::uint64_t& key)
+{
+    std::uint64_t value = key;
+    for (int i = 0; i < 64; ++i)
+        value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    return value;
+}
+
+void RunWorkload(const ZipfGenerator& zipf, std::size_t num_shards,
+                 std::size_t num_threads)
+{
+    Cache<std::uint64_t, std::uint64_t> cache(kCapacity, nullptr, num_shards);
+
+    std::vector<std::thread> workers;
+    Clock::time_point start = Clock::now();
+    for (std::size_t t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&cache, &zipf, t]() {
+            std::mt19937_64 rng(t + 1);
+            for (std::size_t i = 0; i < kOpsPerThread; ++i)
+                cache.GetOrCompute(zipf(rng), Compute);
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    double elapsed = Seconds(Clock::now() - start).count();
+
+    CacheStats stats = cache.GetStats();
+    std::cout << "Shards = " << num_shards
+              << ", Threads = " << num_threads
+              << ", Throughput = "
+              << (num_threads * kOpsPerThread) / elapsed / 1e6 << " Mops/s"
+              << ", Hit Rate = " << stats.HitRate()
+              << ", Evictions = " << stats.evictions
+              << ", Coalesced = " << stats.coalesced << std::endl;
+}
+
+int main(void)
+{
+    ZipfGenerator zipf(kNumKeys, kZipfSkew);
+    std::size_t max_threads =
+        std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+    std::cout << "Keys = " << kNumKeys << ", Capacity = " << kCapacity
+              << ", Zipf Skew = " << kZipfSkew << std::endl;
+    for (std::size_t num_shards : {1, 16, 64}) {
+        for (std::size_t num_threads = 1; num_threads <= max_threads;
+             num_threads *= 2)
+            RunWorkload(zipf, num_shards, num_threads);
+    }
+
+    return 0;
+}
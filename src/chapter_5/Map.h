@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <utility>
 #include <forward_list>
 #include <functional>
 #include <cstddef>
@@ -50,6 +51,14 @@ public:
     float
     LoadFactor() const;
 
+    /*!
+     * \brief Grow the table so that \a count elements fit without a rehash.
+     *
+     * Reserve() never shrinks the table.
+     */
+    void
+    Reserve(std::size_t count);
+
     /*!
      * \brief Insert a key/value pair.
      *
@@ -81,6 +90,15 @@ public:
     Value*
     Get(const Key& key);
 
+    /*!
+     * \brief Call \a visit(key, value) on every entry in the map.
+     *
+     * Entries are visited in bucket order.
+     */
+    template <typename Visitor>
+    void
+    ForEach(Visitor visit) const;
+
 private:
     using Chain   = std::forward_list<std::pair<Key, Value>>;
     using Buckets = std::vector<Chain>;
@@ -99,10 +117,11 @@ private:
     /*!
      * \brief Trigger a rehashing of the entire table.
      *
-     * A Rehash() implies doubling the number of buckets and then re-inserting
-     * all key/value pairs that were present prior to the rehash event.
+     * A Rehash() implies resizing the table to \a bucket_count buckets and
+     * then re-inserting all key/value pairs that were present prior to the
+     * rehash event.
      */
-    void Rehash();
+    void Rehash(std::size_t bucket_count);
 
     Buckets        buckets_; /*!< Hash table buckets. */
     std::size_t    size_;    /*!< Number of elements stored in the table. */
@@ -110,13 +129,13 @@ private:
 }; // end Map
 
 template <typename Key, typename Value>
-void Map<Key, Value>::Rehash()
+void Map<Key, Value>::Rehash(std::size_t bucket_count)
 {
     /* Temporary copy of the entire map. */
-    Buckets tmp = buckets_;
+    Buckets tmp = std::move(buckets_);
 
-    /* Double the number of buckets. */
-    buckets_ = std::vector<Chain>(buckets_.capacity() * 2);
+    /* Resize the bucket array. */
+    buckets_ = std::vector<Chain>(bucket_count);
     size_    = 0;
 
     /* Re-insert all key/value pairs. */
@@ -143,6 +162,18 @@ Map<Key, Value>::LoadFactor() const
     return (size / num_buckets);
 }
 
+template <typename Key, typename Value>
+void
+Map<Key, Value>::Reserve(std::size_t count)
+{
+    /* Smallest bucket count that keeps count elements under the load
+       factor threshold. */
+    std::size_t bucket_count =
+        static_cast<std::size_t>(count / kLoadFactorThreshold) + 1;
+    if (bucket_count > buckets_.size())
+        Rehash(bucket_count);
+}
+
 template <typename Key, typename Value>
 void
 Map<Key, Value>::Insert(const Key& key, const Value& value)
@@ -166,7 +197,7 @@ Map<Key, Value>::Insert(const Key& key, const Value& value)
     /* Trigger a rehash if the insertion has pushed us over the load factor
        threshold. */
     if (LoadFactor() >= kLoadFactorThreshold)
-        Rehash();
+        Rehash(buckets_.capacity() * 2);
 }
 
 template <typename Key, typename Value>
@@ -216,3 +247,14 @@ Map<Key, Value>::Get(const Key& key)
     }
     return nullptr;
 }
+
+template <typename Key, typename Value>
+template <typename Visitor>
+void
+Map<Key, Value>::ForEach(Visitor visit) const
+{
+    for (const Chain& chain : buckets_) {
+        for (const auto& kv : chain)
+            visit(kv.first, kv.second);
+    }
+}
@@ -0,0 +1,623 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <string_view>
+#include <type_traits>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Map.h"
+
+/*
+ * Snapshot file layout. All offsets are relative to the start of the file so
+ * the file can be mapped at any address. Integers use the byte order of the
+ * machine that wrote the file; kSnapshotByteOrder catches a mismatch.
+ *
+ *   SnapshotHeader
+ *   uint64_t buckets[bucket_count + 1]  Index of each bucket's first slot.
+ *   SnapshotSlot slots[size]            Entries grouped by bucket.
+ *   char strings[]                      String key bytes (string keys only).
+ *
+ * Each section starts on a kSnapshotAlignment byte boundary.
+ */
+
+static const char          kSnapshotMagic[8]  = {'G', 'A', 'M', 'A',
+                                                 'P', 'S', 'N', 'P'};
+static const std::uint32_t kSnapshotVersion   = 1;
+static const std::uint32_t kSnapshotByteOrder = 0x01020304;
+static const std::size_t   kSnapshotAlignment = 64;
+
+/*!
+ * \struct SnapshotHeader
+ * \brief The SnapshotHeader struct describes the layout of a snapshot file.
+ */
+struct SnapshotHeader
+{
+    char          magic[8];       /*!< Always kSnapshotMagic. */
+    std::uint32_t version;        /*!< Format version. */
+    std::uint32_t byte_order;     /*!< Always kSnapshotByteOrder. */
+    std::uint32_t key_size;       /*!< sizeof(Key), 0 for string keys. */
+    std::uint32_t value_size;     /*!< sizeof(Value). */
+    std::uint32_t slot_size;      /*!< sizeof(SnapshotSlot). */
+    std::uint32_t reserved;       /*!< Padding, always 0. */
+    std::uint64_t bucket_count;   /*!< Number of buckets, a power of two. */
+    std::uint64_t size;           /*!< Number of entries. */
+    std::uint64_t buckets_offset; /*!< Offset of the bucket index. */
+    std::uint64_t slots_offset;   /*!< Offset of the slot array. */
+    std::uint64_t strings_offset; /*!< Offset of the string pool. */
+    std::uint64_t file_size;      /*!< Total file size in bytes. */
+};
+
+/*!
+ * \struct SnapshotSlot
+ * \brief The SnapshotSlot struct stores a fixed width key/value pair.
+ */
+template <typename Key, typename Value,
+          bool IsString = std::is_same<Key, std::string>::value>
+struct SnapshotSlot
+{
+    Key   key;   /*!< Key stored inline. */
+    Value value; /*!< Value stored inline. */
+};
+
+/*!
+ * \struct SnapshotSlot
+ * \brief The SnapshotSlot struct stores a string key by reference.
+ */
+template <typename Key, typename Value>
+struct SnapshotSlot<Key, Value, true>
+{
+    std::uint64_t key_offset; /*!< Key offset within the string pool. */
+    std::uint64_t key_length; /*!< Key length in bytes. */
+    Value         value;      /*!< Value stored inline. */
+};
+
+/*!
+ * \brief Return the 64-bit FNV-1a hash of \a length bytes at \a data.
+ *
+ * Snapshots cannot use std::hash because its result is allowed to change
+ * between builds and processes.
+ */
+inline std::uint64_t
+SnapshotHash(const void* data, std::size_t length)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*!
+ * \brief Round \a offset up to the next kSnapshotAlignment boundary.
+ */
+inline std::uint64_t
+SnapshotAlign(std::uint64_t offset)
+{
+    return (offset + kSnapshotAlignment - 1) & ~(kSnapshotAlignment - 1);
+}
+
+/*!
+ * \class MapSnapshot
+ * \brief The MapSnapshot class answers queries against a mapped snapshot.
+ *
+ * A snapshot is a read-only, memory mapped image of a Map written by
+ * WriteSnapshot(). Opening a snapshot only validates its header so lookups
+ * can start immediately and pages are faulted in on demand. Each lookup
+ * validates the one bucket it reads. Keys must either be std::string or a
+ * trivially copyable type with a unique object representation, values must
+ * be trivially copyable.
+ */
+template <typename Key, typename Value>
+class MapSnapshot
+{
+public:
+    static constexpr bool
+    kStringKey = std::is_same<Key, std::string>::value; /*!< Key layout. */
+
+    using KeyView = typename std::conditional<kStringKey,
+                                              std::string_view,
+                                              Key>::type;
+    using Slot    = SnapshotSlot<Key, Value>;
+
+    static_assert(std::is_trivially_copyable<Value>::value,
+                  "snapshot values must be trivially copyable");
+    static_assert(kStringKey ||
+                  (std::is_trivially_copyable<Key>::value &&
+                   std::has_unique_object_representations<Key>::value),
+                  "snapshot keys must be std::string or plain old data");
+    static_assert(alignof(Slot) <= kSnapshotAlignment,
+                  "snapshot slots are over aligned");
+
+    MapSnapshot() = default;
+    ~MapSnapshot() { Close(); }
+    MapSnapshot(const MapSnapshot&) = delete;
+    MapSnapshot& operator=(const MapSnapshot&) = delete;
+    MapSnapshot(MapSnapshot&& other) noexcept { *this = std::move(other); }
+    MapSnapshot& operator=(MapSnapshot&& other) noexcept;
+
+    /*!
+     * \brief Map the snapshot at \a path into memory.
+     * \return \c true if the file exists and holds a snapshot whose layout
+     *         matches this Key and Value.
+     */
+    bool
+    Open(const std::string& path);
+
+    /*!
+     * \brief Unmap the snapshot.
+     */
+    void
+    Close();
+
+    /*!
+     * \brief Return \c true if a snapshot is mapped.
+     */
+    bool
+    IsOpen() const { return (nullptr != data_); }
+
+    /*!
+     * \brief Return the number of elements in the snapshot.
+     */
+    std::size_t
+    Size() const { return IsOpen() ? Header().size : 0; }
+
+    /*!
+     * \brief Return \c true if the snapshot contains no elements.
+     */
+    bool
+    Empty() const { return (0 == Size()); }
+
+    /*!
+     * \brief Return a pointer to the value associated with \a key.
+     * \return A pointer into the mapping holding the value associated with
+     *         \a key. If \a key does not reference any value in the
+     *         snapshot, nullptr is returned.
+     */
+    const Value*
+    Get(const KeyView& key) const;
+
+    /*!
+     * \brief Call \a visit(key, value) on every entry in the snapshot.
+     *
+     * For string keys, \a key is a std::string_view into the mapping.
+     */
+    template <typename Visitor>
+    void
+    ForEach(Visitor visit) const;
+
+    /*!
+     * \brief Return a mutable Map holding a copy of every entry.
+     *
+     * The Map is sized up front so that no rehash occurs while it is filled.
+     */
+    Map<Key, Value>
+    Thaw() const;
+
+private:
+    /*!
+     * \brief Return the hash of \a key used to pick its bucket.
+     */
+    static std::uint64_t
+    Hash(const KeyView& key);
+
+    const SnapshotHeader&
+    Header() const { return *reinterpret_cast<const SnapshotHeader*>(data_); }
+
+    const std::uint64_t*
+    Buckets() const
+    {
+        return reinterpret_cast<const std::uint64_t*>(
+            data_ + Header().buckets_offset);
+    }
+
+    const Slot*
+    Slots() const
+        { return reinterpret_cast<const Slot*>(data_ + Header().slots_offset); }
+
+    /*!
+     * \brief Return the key stored in \a slot.
+     */
+    KeyView
+    SlotKey(const Slot& slot) const;
+
+    const char* data_ = nullptr; /*!< Start of the mapping. */
+    std::size_t size_ = 0;       /*!< Length of the mapping in bytes. */
+}; // end MapSnapshot
+
+/*!
+ * \class SnapshotFileWriter
+ * \brief The SnapshotFileWriter class streams a file in fixed size chunks.
+ *
+ * Writes are collected in a kSnapshotChunkSize byte buffer that is handed to
+ * the kernel whenever it fills up, so a snapshot never has to be assembled
+ * in memory. After the first failure every later call is ignored.
+ */
+class SnapshotFileWriter
+{
+public:
+    explicit SnapshotFileWriter(int fd) : fd_(fd)
+        { buffer_.reserve(kSnapshotChunkSize); }
+
+    /*!
+     * \brief Append \a length bytes at \a data.
+     */
+    void
+    Write(const void* data, std::size_t length);
+
+    /*!
+     * \brief Append zeros until \a offset bytes have been written.
+     */
+    void
+    PadTo(std::uint64_t offset);
+
+    /*!
+     * \brief Write out the buffered bytes.
+     * \return \c true if every byte appended so far was written.
+     */
+    bool
+    Flush();
+
+private:
+    static const std::size_t
+    kSnapshotChunkSize = 1 << 20; /*!< Bytes buffered between writes. */
+
+    int               fd_;         /*!< Destination file. */
+    std::vector<char> buffer_;     /*!< Bytes not yet written. */
+    std::uint64_t     offset_ = 0; /*!< Bytes appended so far. */
+    bool              ok_ = true;  /*!< No write has failed. */
+}; // end SnapshotFileWriter
+
+inline void
+SnapshotFileWriter::Write(const void* data, std::size_t length)
+{
+    const char* bytes = static_cast<const char*>(data);
+    offset_ += length;
+    while (ok_ && (length > 0)) {
+        std::size_t count = std::min(length,
+                                     kSnapshotChunkSize - buffer_.size());
+        buffer_.insert(buffer_.end(), bytes, bytes + count);
+        bytes  += count;
+        length -= count;
+        if (kSnapshotChunkSize == buffer_.size())
+            Flush();
+    }
+}
+
+inline void
+SnapshotFileWriter::PadTo(std::uint64_t offset)
+{
+    static const char kZeros[kSnapshotAlignment] = {};
+    while (offset_ < offset)
+        Write(kZeros, std::min<std::uint64_t>(offset - offset_,
+                                              sizeof(kZeros)));
+}
+
+inline bool
+SnapshotFileWriter::Flush()
+{
+    const char* data   = buffer_.data();
+    std::size_t length = buffer_.size();
+    while (ok_ && (length > 0)) {
+        ssize_t count = ::write(fd_, data, length);
+        if (count < 0) {
+            ok_ = (EINTR == errno);
+            continue;
+        }
+        data   += count;
+        length -= count;
+    }
+    buffer_.clear();
+    return ok_;
+}
+
+/*!
+ * \brief Flush the directory entry of \a path to stable storage.
+ * \return \c true if the directory containing \a path was synced.
+ */
+inline bool
+SnapshotSyncDirectory(const std::string& path)
+{
+    std::string::size_type slash = path.rfind('/');
+    std::string directory = (std::string::npos == slash) ?
+                            "." : path.substr(0, slash + 1);
+
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return false;
+
+    bool synced = (0 == ::fsync(fd));
+    return (0 == ::close(fd)) && synced;
+}
+
+/*!
+ * \brief Write \a map to \a path in the MapSnapshot file format.
+ *
+ * The snapshot is streamed to a uniquely named temporary file next to
+ * \a path, synced, and then renamed over \a path, so readers and
+ * concurrent writers never observe a partially written snapshot and a crash
+ * leaves either the old or the new snapshot in place. Slot padding is
+ * written as zeros, but padding inside a Value is copied from \a map as is.
+ *
+ * \return \c true if the snapshot was written and made durable.
+ */
+template <typename Key, typename Value>
+bool
+WriteSnapshot(const Map<Key, Value>& map, const std::string& path)
+{
+    using Snapshot = MapSnapshot<Key, Value>;
+    using Slot     = typename Snapshot::Slot;
+
+    /* Use a power of two bucket count giving a load factor of at most 1. */
+    std::uint64_t bucket_count = 1;
+    while (bucket_count < map.Size())
+        bucket_count *= 2;
+
+    /* Assign every entry to a bucket and count the entries per bucket. */
+    struct Entry
+    {
+        std::uint64_t bucket;
+        const Key*    key;
+        const Value*  value;
+    };
+    std::vector<Entry>         entries;
+    std::vector<std::uint64_t> buckets(bucket_count + 1, 0);
+    std::uint64_t              strings_size = 0;
+    entries.reserve(map.Size());
+    map.ForEach([&](const Key& key, const Value& value) {
+        std::uint64_t hash = 0;
+        if constexpr (Snapshot::kStringKey) {
+            hash          = SnapshotHash(key.data(), key.size());
+            strings_size += key.size();
+        } else {
+            hash = SnapshotHash(&key, sizeof(Key));
+        }
+        std::uint64_t bucket = hash & (bucket_count - 1);
+        entries.push_back({bucket, &key, &value});
+        buckets[bucket + 1]++;
+    });
+    for (std::uint64_t i = 0; i < bucket_count; ++i)
+        buckets[i + 1] += buckets[i];
+
+    /* Order the entries by bucket so the slots can be written in sequence. */
+    std::vector<std::uint64_t> cursors(buckets.begin(), buckets.end() - 1);
+    std::vector<std::size_t>   order(entries.size());
+    for (std::size_t i = 0; i < entries.size(); ++i)
+        order[cursors[entries[i].bucket]++] = i;
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version        = kSnapshotVersion;
+    header.byte_order     = kSnapshotByteOrder;
+    header.key_size       = Snapshot::kStringKey ? 0 : sizeof(Key);
+    header.value_size     = sizeof(Value);
+    header.slot_size      = sizeof(Slot);
+    header.bucket_count   = bucket_count;
+    header.size           = entries.size();
+    header.buckets_offset = SnapshotAlign(sizeof(SnapshotHeader));
+    header.slots_offset   = SnapshotAlign(header.buckets_offset +
+                                          buckets.size() * sizeof(buckets[0]));
+    header.strings_offset = SnapshotAlign(header.slots_offset +
+                                          entries.size() * sizeof(Slot));
+    header.file_size      = header.strings_offset + strings_size;
+
+    std::string tmp_path = path + ".XXXXXX";
+    int fd = ::mkstemp(tmp_path.data());
+    if (fd < 0)
+        return false;
+
+    /* mkstemp() makes the file private to its owner, snapshots are not. */
+    SnapshotFileWriter writer(fd);
+    bool written = (0 == ::fchmod(fd, 0644));
+    writer.Write(&header, sizeof(header));
+    writer.PadTo(header.buckets_offset);
+    writer.Write(buckets.data(), buckets.size() * sizeof(buckets[0]));
+    writer.PadTo(header.slots_offset);
+
+    /* String keys are pooled in slot order. */
+    std::uint64_t string_cursor = 0;
+    for (std::size_t i : order) {
+        /* Zero the padding too, the slot is copied to the file byte for
+           byte. */
+        Slot slot;
+        std::memset(&slot, 0, sizeof(Slot));
+        if constexpr (Snapshot::kStringKey) {
+            slot.key_offset = string_cursor;
+            slot.key_length = entries[i].key->size();
+            string_cursor  += entries[i].key->size();
+        } else {
+            slot.key = *entries[i].key;
+        }
+        slot.value = *entries[i].value;
+        writer.Write(&slot, sizeof(Slot));
+    }
+
+    writer.PadTo(header.strings_offset);
+    if constexpr (Snapshot::kStringKey) {
+        for (std::size_t i : order)
+            writer.Write(entries[i].key->data(), entries[i].key->size());
+    }
+
+    written = writer.Flush() && written && (0 == ::fsync(fd));
+    written = (0 == ::close(fd)) && written;
+    if (!written || (0 != std::rename(tmp_path.c_str(), path.c_str()))) {
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+
+    return SnapshotSyncDirectory(path);
+}
+
+template <typename Key, typename Value>
+MapSnapshot<Key, Value>&
+MapSnapshot<Key, Value>::operator=(MapSnapshot&& other) noexcept
+{
+    if (this != &other) {
+        Close();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+    return *this;
+}
+
+template <typename Key, typename Value>
+bool
+MapSnapshot<Key, Value>::Open(const std::string& path)
+{
+    Close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if ((0 != ::fstat(fd, &info)) ||
+        (static_cast<std::size_t>(info.st_size) < sizeof(SnapshotHeader))) {
+        ::close(fd);
+        return false;
+    }
+
+    /* The mapping stays valid after the descriptor is closed. */
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == data)
+        return false;
+
+    data_ = static_cast<const char*>(data);
+    size_ = size;
+
+    /* Reject files written for a different layout or that are truncated. */
+    const SnapshotHeader& header = Header();
+    std::uint64_t buckets_end = header.buckets_offset +
+        (header.bucket_count + 1) * sizeof(std::uint64_t);
+    bool valid =
+        (0 == std::memcmp(header.magic, kSnapshotMagic,
+                          sizeof(header.magic))) &&
+        (kSnapshotVersion == header.version) &&
+        (kSnapshotByteOrder == header.byte_order) &&
+        ((kStringKey ? 0 : sizeof(Key)) == header.key_size) &&
+        (sizeof(Value) == header.value_size) &&
+        (sizeof(Slot) == header.slot_size) &&
+        (header.bucket_count > 0) &&
+        (0 == (header.bucket_count & (header.bucket_count - 1))) &&
+        (header.bucket_count < size_) &&
+        (header.size < size_) &&
+        (header.file_size == size_) &&
+        (0 == header.buckets_offset % kSnapshotAlignment) &&
+        (0 == header.slots_offset % kSnapshotAlignment) &&
+        (buckets_end <= header.slots_offset) &&
+        (header.slots_offset + header.size * sizeof(Slot) <=
+            header.strings_offset) &&
+        (header.strings_offset <= header.file_size) &&
+        (Buckets()[header.bucket_count] == header.size);
+    if (!valid) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+template <typename Key, typename Value>
+void
+MapSnapshot<Key, Value>::Close()
+{
+    if (!data_)
+        return;
+
+    ::munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+template <typename Key, typename Value>
+std::uint64_t
+MapSnapshot<Key, Value>::Hash(const KeyView& key)
+{
+    if constexpr (kStringKey)
+        return SnapshotHash(key.data(), key.size());
+    else
+        return SnapshotHash(&key, sizeof(Key));
+}
+
+template <typename Key, typename Value>
+typename MapSnapshot<Key, Value>::KeyView
+MapSnapshot<Key, Value>::SlotKey(const Slot& slot) const
+{
+    if constexpr (kStringKey) {
+        /* Guard against a corrupt slot pointing outside the string pool. */
+        const SnapshotHeader& header = Header();
+        std::uint64_t pool_size = header.file_size - header.strings_offset;
+        if ((slot.key_offset > pool_size) ||
+            (slot.key_length > pool_size - slot.key_offset))
+            return {};
+
+        return std::string_view(data_ + header.strings_offset + slot.key_offset,
+                                slot.key_length);
+    } else {
+        return slot.key;
+    }
+}
+
+template <typename Key, typename Value>
+const Value*
+MapSnapshot<Key, Value>::Get(const KeyView& key) const
+{
+    if (!IsOpen())
+        return nullptr;
+
+    std::uint64_t bucket = Hash(key) & (Header().bucket_count - 1);
+    const std::uint64_t* buckets = Buckets();
+    const Slot*          slots   = Slots();
+    std::uint64_t        first   = buckets[bucket];
+    std::uint64_t        last    = buckets[bucket + 1];
+
+    /* Open() does not read the bucket index, reject a corrupt bucket here. */
+    if ((first > last) || (last > Header().size))
+        return nullptr;
+
+    for (std::uint64_t i = first; i < last; ++i) {
+        if (SlotKey(slots[i]) == key)
+            return &slots[i].value;
+    }
+    return nullptr;
+}
+
+template <typename Key, typename Value>
+template <typename Visitor>
+void
+MapSnapshot<Key, Value>::ForEach(Visitor visit) const
+{
+    if (!IsOpen())
+        return;
+
+    const Slot* slots = Slots();
+    for (std::size_t i = 0; i < Size(); ++i)
+        visit(SlotKey(slots[i]), slots[i].value);
+}
+
+template <typename Key, typename Value>
+Map<Key, Value>
+MapSnapshot<Key, Value>::Thaw() const
+{
+    Map<Key, Value> map;
+    map.Reserve(Size());
+    ForEach([&map](const KeyView& key, const Value& value)
+        { map.Insert(Key(key), value); });
+
+    return map;
+}
@@ -1,10 +1,12 @@
 #include <queue>
 #include <string>
+#include <vector>
 #include <forward_list>
 #include <unordered_set>
 #include <iostream>
 
 #include "Graph.h"
+#include "MultiSourceBfs.h"
 
 bool IsMangoSeller(const std::string& name)
 {
@@ -69,5 +71,19 @@ int main(void)
                   << mango_seller << std::endl;
     }
 
+    /* Answer the same question for several people in one batched search. */
+    MultiSourceBfs<std::string>      batched(network);
+    std::vector<std::string>         people = {"Ivan", "Claire", "Alice", "Bob"};
+    std::vector<BfsHit<std::string>> hits = batched.Search(people,
+                                                           IsMangoSeller);
+    for (std::size_t i = 0; i < people.size(); ++i) {
+        std::cout << people[i] << ": ";
+        if (hits[i].found)
+            std::cout << hits[i].node << " (" << hits[i].distance << " hops)";
+        else
+            std::cout << "no mango seller";
+        std::cout << std::endl;
+    }
+
     return 0;
 }
@@ -0,0 +1,470 @@
+#include <queue>
+#include <random>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#if __has_include(<linux/perf_event.h>)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define GA_HAVE_PERF_EVENT 1
+#endif
+
+#include "Graph.h"
+#include "CompactGraph.h"
+#include "GraphOrdering.h"
+#include "MultiSourceBfs.h"
+
+using Network    = Graph<std::uint32_t, false>;
+using Reversible = Graph<std::uint32_t, true>;
+using Compact    = CompactGraph<std::uint32_t>;
+using Clock      = std::chrono::steady_clock;
+using Seconds    = std::chrono::duration<double>;
+
+static const std::uint32_t kNumNodes      = 200000;
+static const std::uint32_t kNumEdges      = 1000000;
+static const std::uint32_t kSellerRate    = 5000;
+static const std::size_t   kNumQueries    = 2048;
+static const std::uint32_t kRmatScale     = 18;
+static const std::uint32_t kRmatDegree    = 8;
+static const std::uint32_t kGridSide      = 512;
+static const std::size_t   kNumTraversals = 16;
+
+bool IsSeller(std::uint32_t node)
+{
+    return (0 == node % kSellerRate);
+}
+
+/*!
+ * \brief Search for the nearest seller from \a start one query at a time.
+ *
+ * SearchOne() is the single-source BFS of ChapterSix.cc with the distance of
+ * the match recorded alongside it.
+ */
+BfsHit<std::uint32_t> SearchOne(const Network& network, std::uint32_t start)
+{
+    std::unordered_map<std::uint32_t, std::size_t> distance;
+    std::queue<std::uint32_t>                      buffer;
+
+    distance[start] = 0;
+    buffer.push(start);
+    while (!buffer.empty()) {
+        std::uint32_t candidate = buffer.front();
+        buffer.pop();
+
+        std::size_t level = distance[candidate];
+        if (IsSeller(candidate))
+            return {true, candidate, level};
+
+        for (std::uint32_t neighbor : network.GetNeighbors(candidate)) {
+            if (distance.emplace(neighbor, level + 1).second)
+                buffer.push(neighbor);
+        }
+    }
+
+    return {};
+}
+
+/*!
+ * \brief Compare batched searches with single-source searches in a loop.
+ */
+void BenchmarkBatchedSearch(std::mt19937& rng)
+{
+    std::uniform_int_distribution<std::uint32_t> node(0, kNumNodes - 1);
+
+    std::vector<Network::Edge> edges;
+    for (std::uint32_t i = 0; i < kNumNodes; ++i)
+        edges.emplace_back(i, (i + 1) % kNumNodes);
+    while (edges.size() < kNumEdges)
+        edges.emplace_back(node(rng), node(rng));
+    Network network = Network::BulkLoad(std::move(edges));
+
+    std::vector<std::uint32_t> sources;
+    for (std::size_t i = 0; i < kNumQueries; ++i)
+        sources.push_back(node(rng));
+
+    Clock::time_point start = Clock::now();
+    std::vector<BfsHit<std::uint32_t>> single;
+    for (std::uint32_t source : sources)
+        single.push_back(SearchOne(network, source));
+    double single_time = Seconds(Clock::now() - start).count();
+
+    start = Clock::now();
+    MultiSourceBfs<std::uint32_t> batched(network);
+    double index_time = Seconds(Clock::now() - start).count();
+
+    start = Clock::now();
+    std::vector<BfsHit<std::uint32_t>> multi = batched.Search(sources,
+                                                              IsSeller);
+    double multi_time = Seconds(Clock::now() - start).count();
+
+    /* Ties may resolve to different sellers, so compare distances only. */
+    bool match = true;
+    for (std::size_t i = 0; i < kNumQueries; ++i) {
+        match = match && (single[i].found == multi[i].found) &&
+                (single[i].distance == multi[i].distance);
+    }
+
+    std::cout << "Nodes = " << kNumNodes << ", Edges = " << kNumEdges
+              << ", Queries = " << kNumQueries << std::endl;
+    std::cout << "Single-Source BFS = " << kNumQueries / single_time
+              << " queries/s" << std::endl;
+    std::cout << "Multi-Source BFS = " << kNumQueries / multi_time
+              << " queries/s (+" << index_time * 1e3 << " ms to index)"
+              << std::endl;
+    std::cout << "Speedup = " << single_time / multi_time << "x" << std::endl;
+    std::cout << "Distances Match = " << std::boolalpha << match << std::endl;
+}
+
+/*!
+ * \brief Return \c true if \a a and \a b hold the same nodes.
+ */
+bool SameNeighbors(const Reversible::Neighbors& a,
+                   const Reversible::Neighbors& b)
+{
+    std::vector<std::uint32_t> lhs(a.begin(), a.end());
+    std::vector<std::uint32_t> rhs(b.begin(), b.end());
+    std::sort(lhs.begin(), lhs.end());
+    std::sort(rhs.begin(), rhs.end());
+    return (lhs == rhs);
+}
+
+/*!
+ * \brief Return \c true if \a graph has exactly the nodes and edges of
+ *        \a expected, in both directions.
+ */
+bool SameGraph(const Reversible& expected, const Reversible& graph)
+{
+    bool match = (expected.Size() == graph.Size());
+    expected.ForEachNode([&](std::uint32_t node, const auto& neighbors) {
+        match = match && graph.HasNode(node) &&
+                SameNeighbors(neighbors, graph.GetNeighbors(node)) &&
+                SameNeighbors(expected.GetInNeighbors(node),
+                              graph.GetInNeighbors(node));
+    });
+    return match;
+}
+
+/*!
+ * \brief Compare BulkLoad() with inserting the same edges one at a time.
+ *
+ * In-edges are tracked so that both passes of BulkLoad() are measured.
+ */
+void BenchmarkBulkLoad(std::mt19937& rng)
+{
+    std::uniform_int_distribution<std::uint32_t> node(0, kNumNodes - 1);
+
+    std::vector<Reversible::Edge> edges;
+    while (edges.size() < kNumEdges)
+        edges.emplace_back(node(rng), node(rng));
+
+    Clock::time_point start = Clock::now();
+    Reversible inserted;
+    for (const Reversible::Edge& edge : edges) {
+        inserted.InsertNode(edge.first);
+        inserted.InsertNode(edge.second);
+        inserted.InsertEdge(edge.first, edge.second);
+    }
+    double insert_time = Seconds(Clock::now() - start).count();
+
+    start = Clock::now();
+    Reversible serial = Reversible::BulkLoad(edges, 1);
+    double serial_time = Seconds(Clock::now() - start).count();
+
+    start = Clock::now();
+    Reversible loaded = Reversible::BulkLoad(edges);
+    double bulk_time = Seconds(Clock::now() - start).count();
+
+    bool match = SameGraph(inserted, serial) && SameGraph(inserted, loaded);
+
+    std::cout << "Nodes = " << kNumNodes << ", Edges = " << kNumEdges
+              << ", Threads = " << std::thread::hardware_concurrency()
+              << std::endl;
+    std::cout << "Per-Edge Insert = " << insert_time * 1e3 << " ms"
+              << std::endl;
+    std::cout << "BulkLoad (1 thread) = " << serial_time * 1e3 << " ms"
+              << std::endl;
+    std::cout << "BulkLoad = " << bulk_time * 1e3 << " ms" << std::endl;
+    std::cout << "Speedup = " << insert_time / bulk_time << "x" << std::endl;
+    std::cout << "Graphs Match = " << std::boolalpha << match << std::endl;
+}
+
+/*!
+ * \class CacheMissCounter
+ * \brief The CacheMissCounter class counts hardware cache misses of the
+ *        calling thread.
+ *
+ * Counting needs perf_event_open(), which may be missing or forbidden, in
+ * which case Valid() is \c false.
+ */
+class CacheMissCounter
+{
+public:
+    CacheMissCounter();
+    ~CacheMissCounter();
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    bool
+    Valid() const { return (fd_ >= 0); }
+
+    void
+    Start();
+
+    /*!
+     * \brief Return the misses counted since Start().
+     */
+    std::uint64_t
+    Stop();
+
+private:
+    int fd_; /*!< perf event descriptor, -1 if unavailable. */
+};
+
+CacheMissCounter::CacheMissCounter() :
+    fd_(-1)
+{
+#ifdef GA_HAVE_PERF_EVENT
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+#ifdef GA_HAVE_PERF_EVENT
+    if (Valid())
+        close(fd_);
+#endif
+}
+
+void CacheMissCounter::Start()
+{
+#ifdef GA_HAVE_PERF_EVENT
+    if (Valid()) {
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+std::uint64_t CacheMissCounter::Stop()
+{
+    std::uint64_t count = 0;
+#ifdef GA_HAVE_PERF_EVENT
+    if (Valid()) {
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd_, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+    }
+#endif
+    return count;
+}
+
+/*!
+ * \brief Load \a edges into a Graph after giving every node a random label.
+ *
+ * Real graphs rarely number their nodes in an order related to their
+ * structure, so the generators' tidy numbering is scrambled first.
+ */
+Network ShuffleLabels(std::vector<Network::Edge> edges, std::uint32_t size,
+                      std::mt19937& rng)
+{
+    std::vector<std::uint32_t> label(size);
+    std::iota(label.begin(), label.end(), 0);
+    std::shuffle(label.begin(), label.end(), rng);
+    for (Network::Edge& edge : edges)
+        edge = {label[edge.first], label[edge.second]};
+
+    return Network::BulkLoad(std::move(edges));
+}
+
+/*!
+ * \brief Build a skewed, social network shaped R-MAT graph.
+ */
+Network MakeRmat(std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uint32_t                          size = 1u << kRmatScale;
+
+    std::vector<Network::Edge> edges;
+    while (edges.size() < std::size_t(size) * kRmatDegree) {
+        std::uint32_t src = 0;
+        std::uint32_t dst = 0;
+        for (std::uint32_t bit = 0; bit < kRmatScale; ++bit) {
+            double p = coin(rng);
+            src = (src << 1) | ((p >= 0.76) ? 1 : 0);
+            dst = (dst << 1) | (((p >= 0.57) && (p < 0.76)) ||
+                                (p >= 0.95) ? 1 : 0);
+        }
+        if (src != dst)
+            edges.emplace_back(src, dst);
+    }
+
+    return ShuffleLabels(std::move(edges), size, rng);
+}
+
+/*!
+ * \brief Build a road network shaped two-way grid graph.
+ */
+Network MakeGrid(std::mt19937& rng)
+{
+    std::vector<Network::Edge> edges;
+    for (std::uint32_t row = 0; row < kGridSide; ++row) {
+        for (std::uint32_t col = 0; col < kGridSide; ++col) {
+            std::uint32_t u = row * kGridSide + col;
+            if (col + 1 < kGridSide) {
+                edges.emplace_back(u, u + 1);
+                edges.emplace_back(u + 1, u);
+            }
+            if (row + 1 < kGridSide) {
+                edges.emplace_back(u, u + kGridSide);
+                edges.emplace_back(u + kGridSide, u);
+            }
+        }
+    }
+
+    return ShuffleLabels(std::move(edges), kGridSide * kGridSide, rng);
+}
+
+/*!
+ * \brief Run a full BFS from every node in \a sources.
+ *
+ * \return The distances from the first source, -1 marks unreachable nodes.
+ */
+std::vector<std::uint32_t> Traverse(const Compact& graph,
+                                    const std::vector<Compact::Id>& sources)
+{
+    static const std::uint32_t kUnreached = std::uint32_t(-1);
+
+    std::vector<std::uint32_t> first;
+    std::vector<std::uint32_t> distance(graph.Size());
+    std::vector<Compact::Id>   queue(graph.Size());
+    for (Compact::Id source : sources) {
+        std::fill(distance.begin(), distance.end(), kUnreached);
+
+        std::size_t head = 0;
+        std::size_t tail = 0;
+        distance[source] = 0;
+        queue[tail++]    = source;
+        while (head < tail) {
+            Compact::Id u = queue[head++];
+            for (Compact::Id v : graph.GetNeighbors(u)) {
+                if (kUnreached == distance[v]) {
+                    distance[v]   = distance[u] + 1;
+                    queue[tail++] = v;
+                }
+            }
+        }
+
+        if (first.empty())
+            first = distance;
+    }
+
+    return first;
+}
+
+/*!
+ * \brief Time BFS and batched searches on \a network under every ordering.
+ */
+void BenchmarkOrderings(const std::string& name, const Network& network,
+                        std::mt19937& rng)
+{
+    using Ordering = Compact::Permutation (*)(const Compact&);
+
+    static const std::vector<std::pair<std::string, Ordering>> kOrderings = {
+        {"Hash Order", nullptr},
+        {"Degree Order", &DegreeOrder<std::uint32_t>},
+        {"Reverse Cuthill-McKee", &ReverseCuthillMcKee<std::uint32_t>},
+        {"Community Order", &CommunityOrder<std::uint32_t>},
+    };
+
+    Compact hashed(network);
+
+    std::uniform_int_distribution<Compact::Id> node(0, hashed.Size() - 1);
+    std::vector<Compact::Id>                   sources;
+    std::vector<std::uint32_t>                 queries;
+    for (std::size_t i = 0; i < kNumTraversals; ++i)
+        sources.push_back(node(rng));
+    for (std::size_t i = 0; i < kNumQueries; ++i)
+        queries.push_back(hashed.GetNode(node(rng)));
+
+    std::vector<std::uint32_t> expected = Traverse(hashed, sources);
+
+    std::cout << std::endl << name << ": Nodes = " << hashed.Size()
+              << ", Edges = " << hashed.EdgeCount() << std::endl;
+
+    CacheMissCounter misses;
+    for (const auto& ordering : kOrderings) {
+        /* The hash order baseline is the Graph's own iteration order. */
+        Clock::time_point    start = Clock::now();
+        Compact::Permutation order(hashed.Size());
+        if (nullptr == ordering.second)
+            std::iota(order.begin(), order.end(), 0);
+        else
+            order = ordering.second(hashed);
+        Compact graph = (nullptr == ordering.second) ? hashed :
+                                                       Compact(hashed, order);
+        double reorder_time = Seconds(Clock::now() - start).count();
+
+        /* Sources are translated in, distances are translated back out. */
+        Compact::Permutation     relabel = InvertPermutation(order);
+        std::vector<Compact::Id> relabeled;
+        for (Compact::Id source : sources)
+            relabeled.push_back(relabel[source]);
+
+        misses.Start();
+        start = Clock::now();
+        std::vector<std::uint32_t> distance = Traverse(graph, relabeled);
+        double        bfs_time   = Seconds(Clock::now() - start).count();
+        std::uint64_t bfs_misses = misses.Stop();
+
+        MultiSourceBfs<std::uint32_t> batched(graph);
+        misses.Start();
+        start = Clock::now();
+        batched.Search(queries, IsSeller);
+        double        multi_time   = Seconds(Clock::now() - start).count();
+        std::uint64_t multi_misses = misses.Stop();
+
+        std::cout << "  " << ordering.first << ": ";
+        if (nullptr != ordering.second)
+            std::cout << "Reorder = " << reorder_time * 1e3 << " ms, ";
+        std::cout << "BFS = " << bfs_time * 1e3 / kNumTraversals << " ms";
+        if (misses.Valid())
+            std::cout << " (" << bfs_misses / kNumTraversals << " misses)";
+        std::cout << ", MS-BFS = " << multi_time * 1e3 << " ms";
+        if (misses.Valid())
+            std::cout << " (" << multi_misses << " misses)";
+        std::cout << ", Distances Match = " << std::boolalpha
+                  << (expected == Unpermute(distance, order)) << std::endl;
+    }
+}
+
+int main(void)
+{
+    std::mt19937 rng(7);
+
+    BenchmarkBulkLoad(rng);
+    BenchmarkBatchedSearch(rng);
+    BenchmarkOrderings("R-MAT", MakeRmat(rng), rng);
+    BenchmarkOrderings("Grid", MakeGrid(rng), rng);
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "Graph.h"
+
+/*!
+ * \class CompactGraph
+ * \brief The CompactGraph class is a read-only, cache friendly copy of a
+ *        Graph.
+ *
+ * Nodes are numbered 0 to Size() - 1 and the out-edges of all nodes are
+ * stored back to back in a compressed sparse row layout, so a traversal
+ * reads neighbor lists from a handful of arrays instead of chasing hash
+ * table buckets. The numbering starts out in the Graph's iteration order and
+ * can be changed with the relabeling constructor to place nodes that are
+ * visited together next to each other in memory.
+ */
+template <typename T>
+class CompactGraph
+{
+public:
+    using Id          = std::uint32_t;
+    using Permutation = std::vector<Id>;
+
+    /*!
+     * \struct Neighbors
+     * \brief Range over the ids of a node's out-neighbors.
+     */
+    struct Neighbors
+    {
+        const Id* first; /*!< First neighbor. */
+        const Id* last;  /*!< One past the last neighbor. */
+
+        const Id* begin() const { return first; }
+        const Id* end() const { return last; }
+        std::size_t size() const { return last - first; }
+    };
+
+    /*!
+     * \brief Copy \a graph, numbering nodes in its iteration order.
+     */
+    template <bool TrackInEdges>
+    explicit CompactGraph(const Graph<T, TrackInEdges>& graph);
+
+    /*!
+     * \brief Copy \a graph, giving node \a order[i] of \a graph the id \a i.
+     *
+     * \a order must be a permutation of the ids of \a graph, such as the
+     * ones produced by the functions in GraphOrdering.h.
+     */
+    CompactGraph(const CompactGraph& graph, const Permutation& order);
+
+    ~CompactGraph() = default;
+    CompactGraph(const CompactGraph&) = default;
+    CompactGraph& operator=(const CompactGraph&) = default;
+    CompactGraph(CompactGraph&&) = default;
+    CompactGraph& operator=(CompactGraph&&) = default;
+
+    /*!
+     * \brief Return the number of nodes.
+     */
+    std::size_t
+    Size() const { return nodes_.size(); }
+
+    /*!
+     * \brief Return the number of edges.
+     */
+    std::size_t
+    EdgeCount() const { return targets_.size(); }
+
+    /*!
+     * \brief Look up the id of \a node.
+     *
+     * \return \c true if \a node is part of the graph.
+     */
+    bool
+    Find(const T& node, Id& id) const;
+
+    /*!
+     * \brief Return the node with id \a id.
+     */
+    const T&
+    GetNode(Id id) const { return nodes_[id]; }
+
+    /*!
+     * \brief Return the position of the first out-edge of \a id among all
+     *        EdgeCount() edges.
+     *
+     * Per-edge data such as weights can be kept in an array that runs
+     * parallel to the neighbor lists.
+     */
+    std::size_t
+    EdgeOffset(Id id) const { return offsets_[id]; }
+
+    /*!
+     * \brief Return the out-neighbors of the node with id \a id.
+     */
+    Neighbors
+    GetNeighbors(Id id) const
+        { return {targets_.data() + offsets_[id],
+                  targets_.data() + offsets_[id + 1]}; }
+
+private:
+    std::unordered_map<T, Id> ids_;     /*!< Node to id. */
+    std::vector<T>            nodes_;   /*!< Id to node. */
+    std::vector<Id>           offsets_; /*!< Start of each neighbor list. */
+    std::vector<Id>           targets_; /*!< Neighbor ids of all nodes. */
+}; // end CompactGraph
+
+/*!
+ * \brief Return the inverse of \a order, mapping each old id to its new id.
+ */
+inline std::vector<std::uint32_t>
+InvertPermutation(const std::vector<std::uint32_t>& order)
+{
+    std::vector<std::uint32_t> inverse(order.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+        inverse[order[i]] = static_cast<std::uint32_t>(i);
+
+    return inverse;
+}
+
+/*!
+ * \brief Translate per-node \a values of a relabeled graph back to the ids
+ *        of the graph it was built from with \a order.
+ */
+template <typename V>
+std::vector<V>
+Unpermute(const std::vector<V>& values,
+          const std::vector<std::uint32_t>& order)
+{
+    std::vector<V> result(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i)
+        result[order[i]] = values[i];
+
+    return result;
+}
+
+template <typename T>
+template <bool TrackInEdges>
+CompactGraph<T>::CompactGraph(const Graph<T, TrackInEdges>& graph)
+{
+    nodes_.reserve(graph.Size());
+    ids_.reserve(graph.Size());
+    graph.ForEachNode([this](const T& node, const auto&) {
+        ids_.emplace(node, static_cast<Id>(nodes_.size()));
+        nodes_.push_back(node);
+    });
+
+    offsets_.reserve(nodes_.size() + 1);
+    offsets_.push_back(0);
+    for (const T& node : nodes_) {
+        for (const T& neighbor : graph.GetNeighbors(node))
+            targets_.push_back(ids_.find(neighbor)->second);
+        offsets_.push_back(static_cast<Id>(targets_.size()));
+    }
+}
+
+template <typename T>
+CompactGraph<T>::CompactGraph(const CompactGraph& graph,
+                              const Permutation& order)
+{
+    Permutation relabel = InvertPermutation(order);
+
+    nodes_.reserve(order.size());
+    ids_.reserve(order.size());
+    offsets_.reserve(order.size() + 1);
+    targets_.reserve(graph.EdgeCount());
+
+    offsets_.push_back(0);
+    for (Id old_id : order) {
+        ids_.emplace(graph.nodes_[old_id], static_cast<Id>(nodes_.size()));
+        nodes_.push_back(graph.nodes_[old_id]);
+
+        /* Sorted neighbor lists keep the reads of a traversal moving
+           forward through memory. */
+        auto first = targets_.end() - targets_.begin();
+        for (Id neighbor : graph.GetNeighbors(old_id))
+            targets_.push_back(relabel[neighbor]);
+        std::sort(targets_.begin() + first, targets_.end());
+        offsets_.push_back(static_cast<Id>(targets_.size()));
+    }
+}
+
+template <typename T>
+bool
+CompactGraph<T>::Find(const T& node, Id& id) const
+{
+    auto it = ids_.find(node);
+    if (it == ids_.end())
+        return false;
+
+    id = it->second;
+    return true;
+}
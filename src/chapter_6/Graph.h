@@ -1,27 +1,60 @@
 #pragma once
 
+#include <vector>
+#include <thread>
 #include <utility>
+#include <iterator>
 #include <algorithm>
 #include <forward_list>
 #include <unordered_map>
 #include <initializer_list>
 #include <cstddef>
 
+#include "NeighborSet.h"
+#include "ParallelSort.h"
+
 /*!
  * \class Graph
  * \brief The Graph class implements an unweighted, directed graph.
+ *
+ * When \a TrackInEdges is \c true, each node also records the set of nodes
+ * with an edge pointing at it. The reverse index lets EraseNode() remove all
+ * incident edges in time proportional to the node's degree at the cost of
+ * storing every edge twice, so it is off unless asked for.
  */
-template <typename T>
+template <typename T, bool TrackInEdges = false>
 class Graph
 {
 public:
-    using EdgeSet = std::pair<T, std::forward_list<T>>;
+    using EdgeSet   = std::pair<T, std::forward_list<T>>;
+    using Edge      = std::pair<T, T>;
+    using Neighbors = NeighborSet<T>;
 
     /*!
      * \brief Construct the graph from a set of EdgeSet objects.
      */
     explicit Graph(const std::initializer_list<EdgeSet>& il={});
 
+    /*!
+     * \brief Construct a graph from an unordered stream of edges.
+     *
+     * The resulting graph is the same as the one produced by inserting each
+     * endpoint and edge in \a edges one at a time. Duplicate edges are
+     * removed with a parallel sort and every node is interned once into the
+     * presized node table. The table itself is filled on the calling thread
+     * since std::unordered_map does not support concurrent insertion, but
+     * the neighbor sets, which hold almost all of the data, are then built
+     * in parallel, each thread owning a disjoint range of nodes. \a T must
+     * be less-than comparable.
+     *
+     * \param edges       Edges to load, duplicates are allowed.
+     * \param num_threads Number of threads used for sorting and for
+     *                    building neighbor sets.
+     */
+    static Graph
+    BulkLoad(std::vector<Edge> edges,
+             std::size_t num_threads=std::thread::hardware_concurrency());
+
     ~Graph() = default;
     Graph(const Graph&) = default;
     Graph& operator=(const Graph&) = default;
@@ -51,7 +84,9 @@ public:
     /*!
      * \brief Delete a node.
      *
-     * EraseNode() does not delete the node's neighbors.
+     * EraseNode() deletes every edge into or out of \a node but does not
+     * delete the node's neighbors. Unless in-edges are tracked, this checks
+     * the edge list of every node in the graph.
      *
      * \return \c true if the node exists and is deleted.
      */
@@ -87,35 +122,69 @@ public:
     HasEdge(const T& src, const T& dst) const;
 
     /*!
-     * \brief Return \a node's list of neighbors.
+     * \brief Return \a node's set of neighbors.
      *
      * Calling GetNeighbors() on a nonexistent node triggers
      * undefined behavior.
      */
-    const std::forward_list<T>&
+    const Neighbors&
     GetNeighbors(const T& node) const
-        { return adj_list_.find(node)->second; }
+        { return adj_list_.find(node)->second.out; }
 
     /*!
-     * \brief Return \a node's list of neighbors.
+     * \brief Return the set of nodes with an edge into \a node.
      *
-     * Calling GetNeighbors() on a nonexistent node triggers
-     * undefined behavior.
+     * GetInNeighbors() is only available when in-edges are tracked. Calling
+     * GetInNeighbors() on a nonexistent node triggers undefined behavior.
+     */
+    const Neighbors&
+    GetInNeighbors(const T& node) const
+    {
+        static_assert(TrackInEdges,
+                      "GetInNeighbors() requires TrackInEdges == true");
+        return adj_list_.find(node)->second.in;
+    }
+
+    /*!
+     * \brief Call \a visit(node, neighbors) on every node in the Graph.
      */
-    std::forward_list<T>&
-    GetNeighbors(const T& node)
-        { return adj_list_.find(node)->second; }
+    template <typename Visitor>
+    void
+    ForEachNode(Visitor visit) const
+    {
+        for (const auto& kv : adj_list_)
+            visit(kv.first, kv.second.out);
+    }
 
 private:
-    using EdgeList = std::forward_list<T>;
-    using AdjMatrix = std::unordered_map<T, EdgeList>;
+    /*!
+     * \brief Edge sets incident to a single node.
+     */
+    struct Node
+    {
+        Neighbors out; /*!< Destinations of edges leaving the node. */
+        Neighbors in;  /*!< Sources of edges entering the node. */
+    };
+
+    using AdjMatrix = std::unordered_map<T, Node>;
+
+    /*!
+     * \brief Fill the \a set member of each node from \a edges.
+     *
+     * \a edges must be sorted and free of duplicates. Each run of edges
+     * sharing a first element becomes that node's \a set. The runs are
+     * split over \a num_threads threads, which only read the node table.
+     */
+    void
+    AssignEdgeRuns(const std::vector<Edge>& edges, Neighbors Node::* set,
+                   std::size_t num_threads);
 
     AdjMatrix   adj_list_; /*!< Adjacency list representation. */
     std::size_t size_;     /*!< Number of nodes in the graph. */
 }; // end Graph
 
-template <typename T>
-Graph<T>::Graph(const std::initializer_list<EdgeSet>& il) :
+template <typename T, bool TrackInEdges>
+Graph<T, TrackInEdges>::Graph(const std::initializer_list<EdgeSet>& il) :
     size_(0)
 {
     for (const EdgeSet& es : il) {
@@ -127,85 +196,184 @@ Graph<T>::Graph(const std::initializer_list<EdgeSet>& il) :
     }
 }
 
-template <typename T>
+template <typename T, bool TrackInEdges>
+Graph<T, TrackInEdges>
+Graph<T, TrackInEdges>::BulkLoad(std::vector<Edge> edges,
+                                 std::size_t num_threads)
+{
+    /* Deduplicate the edge stream, grouping edges by their source. */
+    ParallelSortUnique(edges, num_threads);
+
+    /* Intern every endpoint once. Sources are already sorted so only the
+       destinations need sorting before the two sets are merged. */
+    std::vector<T> srcs;
+    std::vector<T> dsts;
+    dsts.reserve(edges.size());
+    for (const Edge& edge : edges) {
+        if (srcs.empty() || !(srcs.back() == edge.first))
+            srcs.push_back(edge.first);
+        dsts.push_back(edge.second);
+    }
+    ParallelSortUnique(dsts, num_threads);
+
+    std::vector<T> nodes;
+    nodes.reserve(srcs.size() + dsts.size());
+    std::set_union(srcs.cbegin(), srcs.cend(), dsts.cbegin(), dsts.cend(),
+                   std::back_inserter(nodes));
+
+    Graph graph;
+    graph.adj_list_.reserve(nodes.size());
+    for (const T& node : nodes)
+        graph.adj_list_.emplace(node, Node());
+    graph.size_ = nodes.size();
+
+    graph.AssignEdgeRuns(edges, &Node::out, num_threads);
+    if constexpr (TrackInEdges) {
+        /* Regroup the edges by destination to build the reverse index. */
+        for (Edge& edge : edges)
+            std::swap(edge.first, edge.second);
+        ParallelSort(edges.begin(), edges.end(), num_threads);
+        graph.AssignEdgeRuns(edges, &Node::in, num_threads);
+    }
+
+    return graph;
+}
+
+template <typename T, bool TrackInEdges>
+void
+Graph<T, TrackInEdges>::AssignEdgeRuns(const std::vector<Edge>& edges,
+                                       Neighbors Node::* set,
+                                       std::size_t num_threads)
+{
+    if (edges.size() < kMinParallelSize)
+        num_threads = 1;
+    num_threads = std::max<std::size_t>(1, num_threads);
+
+    /* Slice the edges evenly, then move every boundary forward to the start
+       of a run so that no node is shared by two threads. */
+    std::vector<std::size_t> bounds = {0};
+    for (std::size_t t = 1; t < num_threads; ++t) {
+        std::size_t bound = std::max(bounds.back(),
+                                     (edges.size() * t) / num_threads);
+        while ((bound > 0) && (bound < edges.size()) &&
+               (edges[bound].first == edges[bound - 1].first))
+            ++bound;
+        bounds.push_back(bound);
+    }
+    bounds.push_back(edges.size());
+
+    auto assign_slice = [&](std::size_t t) {
+        auto run_begin = edges.cbegin() + bounds[t];
+        auto slice_end = edges.cbegin() + bounds[t + 1];
+        while (run_begin != slice_end) {
+            auto run_end = std::find_if(run_begin, slice_end,
+                [&run_begin](const Edge& edge)
+                    { return !(edge.first == run_begin->first); });
+
+            std::vector<T> neighbors;
+            neighbors.reserve(std::distance(run_begin, run_end));
+            for (auto curr = run_begin; curr != run_end; ++curr)
+                neighbors.push_back(curr->second);
+
+            (adj_list_.find(run_begin->first)->second.*set).Assign(
+                std::move(neighbors));
+            run_begin = run_end;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t t = 1; t < num_threads; ++t)
+        workers.emplace_back(assign_slice, t);
+    assign_slice(0);
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+template <typename T, bool TrackInEdges>
 bool
-Graph<T>::InsertNode(const T& node)
+Graph<T, TrackInEdges>::InsertNode(const T& node)
 {
-    /* Disallow the duplication of nodes. */
-    if (HasNode(node))
+    /* Insert a node with an empty edge list. Disallow the duplication
+       of nodes. */
+    if (!adj_list_.emplace(node, Node()).second)
         return false;
 
-    /* Insert the a node with an empty edge list. */
-    adj_list_[node] = {};
     size_++;
 
     return true;
 }
 
-template <typename T>
+template <typename T, bool TrackInEdges>
 bool
-Graph<T>::EraseNode(const T& node)
+Graph<T, TrackInEdges>::EraseNode(const T& node)
 {
     /* Return false if the node to be erased does not exist. */
-    if (!HasNode(node))
+    auto node_iter = adj_list_.find(node);
+    if (node_iter == adj_list_.end())
         return false;
 
+    /* Remove the edges incident to the node from its neighbors. */
+    const Node& entry = node_iter->second;
+    if constexpr (TrackInEdges) {
+        for (const T& dst : entry.out)
+            adj_list_.find(dst)->second.in.Erase(node);
+        for (const T& src : entry.in)
+            adj_list_.find(src)->second.out.Erase(node);
+    } else {
+        /* Without a reverse index every edge list must be checked. */
+        for (auto& kv : adj_list_)
+            kv.second.out.Erase(node);
+    }
+
     /* Erase the node. */
-    adj_list_.erase(node);
+    adj_list_.erase(node_iter);
     size_--;
 
     return true;
 }
 
-template <typename T>
+template <typename T, bool TrackInEdges>
 bool
-Graph<T>::InsertEdge(const T& src, const T& dst)
+Graph<T, TrackInEdges>::InsertEdge(const T& src, const T& dst)
 {
+    auto src_iter = adj_list_.find(src);
+    if ((src_iter == adj_list_.end()) || !HasNode(dst))
+        return false;
+
     /* Avoid duplication of edges. */
-    if (HasEdge(src, dst))
+    if (!src_iter->second.out.Insert(dst))
         return false;
 
-    adj_list_[src].push_front(dst);
+    if constexpr (TrackInEdges)
+        adj_list_.find(dst)->second.in.Insert(src);
+
     return true;
 }
 
-template <typename T>
+template <typename T, bool TrackInEdges>
 bool
-Graph<T>::EraseEdge(const T& src, const T& dst)
+Graph<T, TrackInEdges>::EraseEdge(const T& src, const T& dst)
 {
     /* Guard against deleting an edge that does not exist. */
-    if (!HasEdge(src, dst))
+    auto src_iter = adj_list_.find(src);
+    if ((src_iter == adj_list_.end()) || !src_iter->second.out.Erase(dst))
         return false;
 
-    /* Search the neighbors list for the target node. */
-    EdgeList& edges = adj_list_[src];
-    auto curr = edges.begin();
-    auto prev = edges.before_begin();
-    while (curr != edges.end()) {
-        if (dst == *curr)
-            break;
-
-        prev = curr;
-        curr++;
-    }
-
-    edges.erase_after(prev);
+    if constexpr (TrackInEdges)
+        adj_list_.find(dst)->second.in.Erase(src);
 
     return true;
 }
 
-template <typename T>
+template <typename T, bool TrackInEdges>
 bool
-Graph<T>::HasEdge(const T& src, const T& dst) const
+Graph<T, TrackInEdges>::HasEdge(const T& src, const T& dst) const
 {
     /* Cannot have an edge with nodes that do not already
        exist in the graph. */
-    if (!HasNode(src) || !HasNode(dst))
+    auto src_iter = adj_list_.find(src);
+    if (src_iter == adj_list_.end())
         return false;
 
-    const EdgeList& edges = adj_list_.find(src)->second;
-    auto search_result =
-        std::find(edges.cbegin(), edges.cend(), dst);
-
-    return (search_result != edges.cend());
+    return src_iter->second.out.Contains(dst);
 }
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "CompactGraph.h"
+
+/*!
+ * \struct UndirectedAdjacency
+ * \brief The UndirectedAdjacency struct holds the neighbors of every node
+ *        with edge directions ignored.
+ *
+ * Each neighbor list is sorted, has no duplicates and no self loops.
+ */
+struct UndirectedAdjacency
+{
+    std::vector<std::uint32_t> offsets; /*!< Start of each neighbor list. */
+    std::vector<std::uint32_t> targets; /*!< Neighbor ids of all nodes. */
+
+    /*!
+     * \brief Build the undirected adjacency of \a graph.
+     */
+    template <typename T>
+    explicit UndirectedAdjacency(const CompactGraph<T>& graph);
+
+    /*!
+     * \brief Return the number of distinct neighbors of \a id.
+     */
+    std::size_t
+    Degree(std::uint32_t id) const { return offsets[id + 1] - offsets[id]; }
+};
+
+template <typename T>
+UndirectedAdjacency::UndirectedAdjacency(const CompactGraph<T>& graph) :
+    offsets(graph.Size() + 1, 0)
+{
+    for (std::uint32_t u = 0; u < graph.Size(); ++u) {
+        for (std::uint32_t v : graph.GetNeighbors(u)) {
+            offsets[u + 1]++;
+            offsets[v + 1]++;
+        }
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    targets.resize(offsets.back());
+    for (std::uint32_t u = 0; u < graph.Size(); ++u) {
+        for (std::uint32_t v : graph.GetNeighbors(u)) {
+            targets[fill[u]++] = v;
+            targets[fill[v]++] = u;
+        }
+    }
+
+    /* Sort, deduplicate and compact every list in place. */
+    std::uint32_t out = 0;
+    for (std::uint32_t u = 0; u < graph.Size(); ++u) {
+        auto first = targets.begin() + offsets[u];
+        auto last  = targets.begin() + offsets[u + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        last = std::remove(first, last, u);
+
+        offsets[u] = out;
+        out = static_cast<std::uint32_t>(
+            std::copy(first, last, targets.begin() + out) - targets.begin());
+    }
+    offsets.back() = out;
+    targets.resize(out);
+}
+
+/*!
+ * \brief Order nodes by decreasing number of edges.
+ *
+ * High degree nodes are the ones touched most often by traversals, so
+ * packing them together keeps the hottest part of every per-node array in a
+ * few cache lines. Ties keep their current order.
+ *
+ * \return The new order, node \a order[i] of \a graph becomes node \a i.
+ */
+template <typename T>
+typename CompactGraph<T>::Permutation
+DegreeOrder(const CompactGraph<T>& graph)
+{
+    std::vector<std::uint32_t> degree(graph.Size(), 0);
+    for (std::uint32_t u = 0; u < graph.Size(); ++u) {
+        for (std::uint32_t v : graph.GetNeighbors(u)) {
+            degree[u]++;
+            degree[v]++;
+        }
+    }
+
+    typename CompactGraph<T>::Permutation order(graph.Size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&degree](std::uint32_t lhs, std::uint32_t rhs)
+                         { return degree[lhs] > degree[rhs]; });
+
+    return order;
+}
+
+/*!
+ * \brief Order nodes with the Reverse Cuthill-McKee algorithm.
+ *
+ * Each connected component is traversed breadth first starting from one of
+ * its lowest degree nodes, visiting the neighbors of a node in increasing
+ * degree order, and the resulting sequence is reversed. Nodes end up close
+ * to their neighbors, which narrows the band of ids a traversal touches at
+ * any one time.
+ *
+ * \return The new order, node \a order[i] of \a graph becomes node \a i.
+ */
+template <typename T>
+typename CompactGraph<T>::Permutation
+ReverseCuthillMcKee(const CompactGraph<T>& graph)
+{
+    UndirectedAdjacency adjacency(graph);
+    auto by_degree = [&adjacency](std::uint32_t lhs, std::uint32_t rhs)
+        { return adjacency.Degree(lhs) < adjacency.Degree(rhs); };
+
+    /* Candidate component roots, lowest degree first. */
+    std::vector<std::uint32_t> roots(graph.Size());
+    std::iota(roots.begin(), roots.end(), 0);
+    std::stable_sort(roots.begin(), roots.end(), by_degree);
+
+    typename CompactGraph<T>::Permutation order;
+    std::vector<bool>                     visited(graph.Size(), false);
+    order.reserve(graph.Size());
+    for (std::uint32_t root : roots) {
+        if (visited[root])
+            continue;
+
+        /* order doubles as the BFS queue of the current component. */
+        std::size_t head = order.size();
+        order.push_back(root);
+        visited[root] = true;
+        while (head < order.size()) {
+            std::uint32_t u     = order[head++];
+            std::size_t   first = order.size();
+            for (std::uint32_t i = adjacency.offsets[u];
+                 i < adjacency.offsets[u + 1]; ++i) {
+                std::uint32_t v = adjacency.targets[i];
+                if (!visited[v]) {
+                    visited[v] = true;
+                    order.push_back(v);
+                }
+            }
+            std::stable_sort(order.begin() + first, order.end(), by_degree);
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+/*!
+ * \brief Order nodes so that communities occupy contiguous id ranges.
+ *
+ * CommunityOrder() follows Rabbit Order. Nodes are visited in increasing
+ * degree order and each one is merged into the neighboring community that
+ * gives the largest modularity gain, if any gain is positive. Merging sums
+ * the edge weights of the two communities, so later decisions see the
+ * aggregated graph. Every merge is recorded in a dendrogram whose depth
+ * first traversal yields the final order: each community, and recursively
+ * each of its sub-communities, is laid out as one block of ids.
+ *
+ * \return The new order, node \a order[i] of \a graph becomes node \a i.
+ */
+template <typename T>
+typename CompactGraph<T>::Permutation
+CommunityOrder(const CompactGraph<T>& graph)
+{
+    using Weights = std::unordered_map<std::uint32_t, double>;
+
+    UndirectedAdjacency adjacency(graph);
+    std::size_t         size = graph.Size();
+
+    std::vector<Weights> edges(size);
+    std::vector<double>  strength(size, 0.0);
+    double               total = 0.0;
+    for (std::uint32_t u = 0; u < size; ++u) {
+        for (std::uint32_t i = adjacency.offsets[u];
+             i < adjacency.offsets[u + 1]; ++i)
+            edges[u][adjacency.targets[i]] = 1.0;
+        strength[u] = static_cast<double>(adjacency.Degree(u));
+        total      += strength[u];
+    }
+
+    /* Union-find over communities, a community is named by its root. */
+    std::vector<std::uint32_t> parent(size);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent](std::uint32_t u) {
+        while (parent[u] != u) {
+            parent[u] = parent[parent[u]];
+            u         = parent[u];
+        }
+        return u;
+    };
+
+    std::vector<std::uint32_t> visit(size);
+    std::iota(visit.begin(), visit.end(), 0);
+    std::stable_sort(visit.begin(), visit.end(),
+                     [&adjacency](std::uint32_t lhs, std::uint32_t rhs)
+                         { return adjacency.Degree(lhs) <
+                                  adjacency.Degree(rhs); });
+
+    std::vector<std::vector<std::uint32_t>> children(size);
+    for (std::uint32_t u : visit) {
+        /* Nodes are only merged away when visited, so u is still a root. */
+        Weights merged;
+        for (const auto& kv : edges[u]) {
+            std::uint32_t v = find(kv.first);
+            if (v != u)
+                merged[v] += kv.second;
+        }
+        edges[u].swap(merged);
+
+        /* Merging u into v changes modularity by
+           2 * (w(u, v) / total - strength(u) * strength(v) / total^2). */
+        std::uint32_t best      = u;
+        double        best_gain = 0.0;
+        for (const auto& kv : edges[u]) {
+            double gain = kv.second * total - strength[u] * strength[kv.first];
+            if (gain > best_gain) {
+                best      = kv.first;
+                best_gain = gain;
+            }
+        }
+        if (best == u)
+            continue;
+
+        parent[u]       = best;
+        strength[best] += strength[u];
+        children[best].push_back(u);
+
+        /* Fold u's edges into best's, stale names are resolved lazily. */
+        if (edges[u].size() > edges[best].size())
+            edges[u].swap(edges[best]);
+        for (const auto& kv : edges[u])
+            edges[best][kv.first] += kv.second;
+        Weights().swap(edges[u]);
+    }
+
+    /* Lay out the dendrogram depth first, a community before its members'
+       sub-communities in the order they were merged. */
+    typename CompactGraph<T>::Permutation order;
+    std::vector<std::uint32_t>            stack;
+    order.reserve(size);
+    for (std::uint32_t root : visit) {
+        if (parent[root] != root)
+            continue;
+
+        stack.push_back(root);
+        while (!stack.empty()) {
+            std::uint32_t u = stack.back();
+            stack.pop_back();
+            order.push_back(u);
+            stack.insert(stack.end(), children[u].rbegin(),
+                         children[u].rend());
+        }
+    }
+
+    return order;
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include "Graph.h"
+#include "CompactGraph.h"
+
+/*!
+ * \struct BfsHit
+ * \brief The BfsHit struct holds the outcome of one breadth first search.
+ */
+template <typename T>
+struct BfsHit
+{
+    bool        found    = false; /*!< A matching node was reached. */
+    T           node     = T();   /*!< Nearest matching node. */
+    std::size_t distance = 0;     /*!< Number of edges to node. */
+};
+
+/*!
+ * \class MultiSourceBfs
+ * \brief The MultiSourceBfs class runs many breadth first searches at once.
+ *
+ * MultiSourceBfs implements MS-BFS over a CompactGraph. Searches are run in
+ * batches of 64 * \a Words sources. Each node carries one bit per search in
+ * its seen, current frontier and next frontier masks, so expanding a node
+ * advances every search that has reached it with a single pass over its
+ * neighbors. A search leaves the batch as soon as it finds a match.
+ *
+ * The masks live in a Scratch that callers running many searches should
+ * keep and pass back in, so that a search costs time proportional to the
+ * part of the graph it explores rather than to the size of the graph.
+ */
+template <typename T, std::size_t Words = 4>
+class MultiSourceBfs
+{
+public:
+    static constexpr std::size_t
+    kBatchSize = 64 * Words; /*!< Searches per adjacency scan. */
+
+private:
+    using Mask = std::array<std::uint64_t, Words>;
+
+public:
+    /*!
+     * \class Scratch
+     * \brief Per-thread working memory for Search().
+     *
+     * Scratch is sized for the graph on first use. Every search leaves it
+     * cleared, and only the nodes the search touched are reset.
+     */
+    class Scratch
+    {
+    private:
+        friend class MultiSourceBfs;
+
+        std::vector<Mask>          seen;          /*!< Searches seen. */
+        std::vector<Mask>          visit;         /*!< Current frontier. */
+        std::vector<Mask>          next;          /*!< Next frontier. */
+        std::vector<signed char>   matches;       /*!< Predicate results. */
+        std::vector<std::uint32_t> touched;       /*!< Nodes with seen set. */
+        std::vector<std::uint32_t> evaluated;     /*!< Nodes with a match. */
+        std::vector<std::uint32_t> frontier;      /*!< Nodes to expand. */
+        std::vector<std::uint32_t> next_frontier; /*!< Nodes reached. */
+    };
+
+    /*!
+     * \brief Index \a graph for batched searches.
+     *
+     * Later changes to \a graph are not seen by the searches.
+     */
+    template <bool TrackInEdges>
+    explicit MultiSourceBfs(const Graph<T, TrackInEdges>& graph) :
+        graph_(graph) { }
+
+    /*!
+     * \brief Search \a graph, which may have been relabeled for locality.
+     */
+    explicit MultiSourceBfs(CompactGraph<T> graph) :
+        graph_(std::move(graph)) { }
+
+    /*!
+     * \brief Find, for every node in \a sources, the nearest node satisfying
+     *        \a pred.
+     *
+     * A source matches itself at distance 0. If several nodes match at the
+     * same distance, any one of them may be reported. Sources that are not
+     * part of the graph find nothing.
+     *
+     * \return One BfsHit per source, in the order of \a sources.
+     */
+    template <typename Predicate>
+    std::vector<BfsHit<T>>
+    Search(const std::vector<T>& sources, Predicate pred,
+           Scratch& scratch) const;
+
+    /*!
+     * \brief Search with working memory allocated for this call only.
+     *
+     * Allocating the Scratch costs time proportional to the size of the
+     * graph, so callers running many searches should keep their own.
+     */
+    template <typename Predicate>
+    std::vector<BfsHit<T>>
+    Search(const std::vector<T>& sources, Predicate pred) const
+    {
+        Scratch scratch;
+        return Search(sources, pred, scratch);
+    }
+
+    /*!
+     * \brief Return the graph being searched.
+     */
+    const CompactGraph<T>&
+    GetGraph() const { return graph_; }
+
+private:
+    static bool
+    Any(const Mask& mask)
+    {
+        return std::any_of(mask.cbegin(), mask.cend(),
+                           [](std::uint64_t w) { return (0 != w); });
+    }
+
+    /*!
+     * \brief Run the searches in [\a first, \a last) of \a sources.
+     */
+    template <typename Predicate>
+    void
+    SearchBatch(const std::vector<T>& sources, std::size_t first,
+                std::size_t last, Scratch& scratch, Predicate& pred,
+                std::vector<BfsHit<T>>& hits) const;
+
+    CompactGraph<T> graph_; /*!< Graph being searched. */
+}; // end MultiSourceBfs
+
+template <typename T, std::size_t Words>
+template <typename Predicate>
+std::vector<BfsHit<T>>
+MultiSourceBfs<T, Words>::Search(const std::vector<T>& sources,
+                                 Predicate pred, Scratch& scratch) const
+{
+    std::vector<BfsHit<T>> hits(sources.size());
+
+    if (scratch.seen.size() != graph_.Size()) {
+        scratch.seen.assign(graph_.Size(), Mask{});
+        scratch.visit.assign(graph_.Size(), Mask{});
+        scratch.next.assign(graph_.Size(), Mask{});
+        scratch.matches.assign(graph_.Size(), -1);
+        scratch.touched.clear();
+        scratch.evaluated.clear();
+    }
+
+    for (std::size_t first = 0; first < sources.size(); first += kBatchSize) {
+        std::size_t last = std::min(first + kBatchSize, sources.size());
+        SearchBatch(sources, first, last, scratch, pred, hits);
+    }
+
+    /* Predicate results are only valid for this call. */
+    for (std::uint32_t id : scratch.evaluated)
+        scratch.matches[id] = -1;
+    scratch.evaluated.clear();
+
+    return hits;
+}
+
+template <typename T, std::size_t Words>
+template <typename Predicate>
+void
+MultiSourceBfs<T, Words>::SearchBatch(const std::vector<T>& sources,
+                                      std::size_t first, std::size_t last,
+                                      Scratch& scratch, Predicate& pred,
+                                      std::vector<BfsHit<T>>& hits) const
+{
+    std::vector<Mask>&          seen          = scratch.seen;
+    std::vector<Mask>&          visit         = scratch.visit;
+    std::vector<Mask>&          next          = scratch.next;
+    std::vector<signed char>&   matches       = scratch.matches;
+    std::vector<std::uint32_t>& touched       = scratch.touched;
+    std::vector<std::uint32_t>& frontier      = scratch.frontier;
+    std::vector<std::uint32_t>& next_frontier = scratch.next_frontier;
+    Mask                        active{};
+
+    /* Cache predicate results, -1 means not yet evaluated. */
+    auto is_match = [&](std::uint32_t id) {
+        if (matches[id] < 0) {
+            matches[id] = pred(graph_.GetNode(id)) ? 1 : 0;
+            scratch.evaluated.push_back(id);
+        }
+        return (1 == matches[id]);
+    };
+
+    /* Reports a hit at node id for every search in found. */
+    auto report = [&](std::uint32_t id, const Mask& found, std::size_t level) {
+        for (std::size_t w = 0; w < Words; ++w) {
+            for (std::uint64_t bits = found[w]; bits; bits &= bits - 1) {
+                std::size_t search = w * 64 + __builtin_ctzll(bits);
+                BfsHit<T>&  hit    = hits[first + search];
+                hit.found    = true;
+                hit.node     = graph_.GetNode(id);
+                hit.distance = level;
+            }
+        }
+    };
+
+    /* Seed the searches, a source that matches itself is done already. */
+    for (std::size_t search = 0; search < last - first; ++search) {
+        std::uint32_t id;
+        if (!graph_.Find(sources[first + search], id))
+            continue;
+
+        Mask bit{};
+        bit[search / 64] = std::uint64_t(1) << (search % 64);
+        if (is_match(id)) {
+            report(id, bit, 0);
+            continue;
+        }
+
+        if (!Any(visit[id]))
+            frontier.push_back(id);
+        if (!Any(seen[id]))
+            touched.push_back(id);
+        seen[id][search / 64]  |= bit[search / 64];
+        visit[id][search / 64] |= bit[search / 64];
+        active[search / 64]    |= bit[search / 64];
+    }
+
+    for (std::size_t level = 1; !frontier.empty() && Any(active); ++level) {
+        /* Expand every frontier node once on behalf of all of its searches. */
+        for (std::uint32_t id : frontier) {
+            Mask searches = visit[id];
+            for (std::size_t w = 0; w < Words; ++w)
+                searches[w] &= active[w];
+            if (!Any(searches))
+                continue;
+
+            for (std::uint32_t neighbor : graph_.GetNeighbors(id)) {
+                Mask reached;
+                for (std::size_t w = 0; w < Words; ++w)
+                    reached[w] = searches[w] & ~seen[neighbor][w];
+                if (!Any(reached))
+                    continue;
+
+                if (!Any(next[neighbor]))
+                    next_frontier.push_back(neighbor);
+                for (std::size_t w = 0; w < Words; ++w)
+                    next[neighbor][w] |= reached[w];
+            }
+        }
+
+        for (std::uint32_t id : frontier)
+            visit[id] = Mask{};
+
+        /* Mark the new frontier seen and retire the searches it satisfies. */
+        for (std::uint32_t id : next_frontier) {
+            if (!Any(seen[id]))
+                touched.push_back(id);
+            for (std::size_t w = 0; w < Words; ++w)
+                seen[id][w] |= next[id][w];
+
+            if (is_match(id)) {
+                Mask found;
+                for (std::size_t w = 0; w < Words; ++w) {
+                    found[w]   = next[id][w] & active[w];
+                    active[w] &= ~found[w];
+                }
+                report(id, found, level);
+            }
+
+            visit[id] = next[id];
+            next[id]  = Mask{};
+        }
+
+        frontier.swap(next_frontier);
+        next_frontier.clear();
+    }
+
+    /* Every node with a bit in any mask has been seen, so clearing the
+       touched nodes leaves the scratch ready for the next batch. */
+    for (std::uint32_t id : touched) {
+        seen[id]  = Mask{};
+        visit[id] = Mask{};
+        next[id]  = Mask{};
+    }
+    touched.clear();
+    frontier.clear();
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <cstddef>
+
+/*!
+ * \class NeighborSet
+ * \brief The NeighborSet class stores the unique neighbors of a graph node.
+ *
+ * Neighbors are kept in a contiguous vector so that traversals walk
+ * sequential memory. Small sets are searched linearly. Once the set grows
+ * past kIndexThreshold elements, a hash index mapping each neighbor to its
+ * slot in the vector is built so that lookups and deletions run in O(1)
+ * amortized time regardless of the node's degree.
+ */
+template <typename T>
+class NeighborSet
+{
+public:
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    NeighborSet() = default;
+    ~NeighborSet() = default;
+    NeighborSet(const NeighborSet&) = default;
+    NeighborSet& operator=(const NeighborSet&) = default;
+    NeighborSet(NeighborSet&&) = default;
+    NeighborSet& operator=(NeighborSet&&) = default;
+
+    /*!
+     * \brief Return the number of neighbors in the set.
+     */
+    std::size_t
+    Size() const { return items_.size(); }
+
+    /*!
+     * \brief Return \c true if the set contains no neighbors.
+     */
+    bool
+    Empty() const { return items_.empty(); }
+
+    /*!
+     * \brief Return \c true if \a item is a member of the set.
+     */
+    bool
+    Contains(const T& item) const { return (Find(item) != kNotFound); }
+
+    /*!
+     * \brief Insert \a item into the set.
+     * \return \c true if \a item was not already a member of the set.
+     */
+    bool
+    Insert(const T& item);
+
+    /*!
+     * \brief Erase \a item from the set.
+     *
+     * Erase() moves the last neighbor into the vacated slot therefore the
+     * iteration order of the remaining neighbors is not preserved.
+     *
+     * \return \c true if \a item was a member of the set and is erased.
+     */
+    bool
+    Erase(const T& item);
+
+    /*!
+     * \brief Replace the contents of the set with \a items.
+     *
+     * Assign() skips the duplicate check performed by Insert() therefore
+     * \a items must not contain duplicates.
+     */
+    void
+    Assign(std::vector<T>&& items);
+
+    const_iterator
+    begin() const { return items_.cbegin(); }
+
+    const_iterator
+    end() const { return items_.cend(); }
+
+private:
+    using Index = std::unordered_map<T, std::size_t>;
+
+    static const std::size_t
+    kIndexThreshold = 16; /*!< Set size above which the hash index is used. */
+    static const std::size_t
+    kNotFound = static_cast<std::size_t>(-1); /*!< Failed Find() result. */
+
+    /*!
+     * \brief Rebuild index_ from the contents of items_.
+     */
+    void
+    BuildIndex();
+
+    /*!
+     * \brief Return the position of \a item in items_ or kNotFound.
+     */
+    std::size_t
+    Find(const T& item) const;
+
+    std::vector<T> items_; /*!< Densely packed neighbors. */
+    Index          index_; /*!< Neighbor to position map (large sets only). */
+}; // end NeighborSet
+
+template <typename T>
+void
+NeighborSet<T>::BuildIndex()
+{
+    index_.clear();
+    index_.reserve(items_.size() * 2);
+    for (std::size_t i = 0; i < items_.size(); ++i)
+        index_.emplace(items_[i], i);
+}
+
+template <typename T>
+std::size_t
+NeighborSet<T>::Find(const T& item) const
+{
+    if (!index_.empty()) {
+        auto search_result = index_.find(item);
+        return (search_result == index_.end()) ?
+            kNotFound : search_result->second;
+    }
+
+    auto search_result = std::find(items_.cbegin(), items_.cend(), item);
+    return (search_result == items_.cend()) ?
+        kNotFound : static_cast<std::size_t>(search_result - items_.cbegin());
+}
+
+template <typename T>
+bool
+NeighborSet<T>::Insert(const T& item)
+{
+    /* Disallow duplicate neighbors. */
+    if (Contains(item))
+        return false;
+
+    items_.push_back(item);
+    if (!index_.empty()) {
+        index_.emplace(item, items_.size() - 1);
+    } else if (items_.size() > kIndexThreshold) {
+        /* The set has outgrown linear search, index every neighbor. */
+        BuildIndex();
+    }
+
+    return true;
+}
+
+template <typename T>
+bool
+NeighborSet<T>::Erase(const T& item)
+{
+    std::size_t pos = Find(item);
+    if (kNotFound == pos)
+        return false;
+
+    if (!index_.empty())
+        index_.erase(items_[pos]);
+
+    /* Fill the hole with the last neighbor so the vector stays dense. */
+    std::size_t last = items_.size() - 1;
+    if (pos != last) {
+        items_[pos] = std::move(items_[last]);
+        if (!index_.empty())
+            index_[items_[pos]] = pos;
+    }
+    items_.pop_back();
+
+    /* Drop the index once the set is small enough to scan linearly. */
+    if (!index_.empty() && (items_.size() <= kIndexThreshold / 2))
+        Index().swap(index_);
+
+    return true;
+}
+
+template <typename T>
+void
+NeighborSet<T>::Assign(std::vector<T>&& items)
+{
+    items_ = std::move(items);
+    if (items_.size() > kIndexThreshold)
+        BuildIndex();
+    else
+        Index().swap(index_);
+}
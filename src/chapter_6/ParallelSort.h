@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
+
+/*! Below this many elements thread startup dominates parallel work. */
+static const std::size_t kMinParallelSize = 1 << 14;
+
+/*!
+ * \brief Sort the range [\a first, \a last) using up to \a num_threads threads.
+ *
+ * The range is split into one chunk per thread and each chunk is sorted
+ * concurrently. Neighboring chunks are then merged pairwise, also in
+ * parallel, until a single sorted run remains. Small ranges are sorted on
+ * the calling thread.
+ */
+template <typename RandomIt, typename Compare = std::less<>>
+void ParallelSort(RandomIt first, RandomIt last, std::size_t num_threads,
+                  Compare comp = Compare())
+{
+    std::size_t size = static_cast<std::size_t>(std::distance(first, last));
+    if ((num_threads < 2) || (size < kMinParallelSize)) {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    /* Chunk boundaries, chunk i spans [bounds[i], bounds[i + 1]). */
+    std::vector<RandomIt> bounds;
+    for (std::size_t i = 0; i < num_threads; ++i)
+        bounds.push_back(first + (size * i) / num_threads);
+    bounds.push_back(last);
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < num_threads; ++i)
+        workers.emplace_back([&bounds, &comp, i]()
+            { std::sort(bounds[i], bounds[i + 1], comp); });
+    for (std::thread& worker : workers)
+        worker.join();
+
+    /* Merge adjacent runs until only one remains. */
+    for (std::size_t width = 1; width < num_threads; width *= 2) {
+        workers.clear();
+        for (std::size_t i = 0; i + width < num_threads; i += 2 * width) {
+            RandomIt lo  = bounds[i];
+            RandomIt mid = bounds[i + width];
+            RandomIt hi  = bounds[std::min(i + 2 * width, num_threads)];
+            workers.emplace_back([lo, mid, hi, &comp]()
+                { std::inplace_merge(lo, mid, hi, comp); });
+        }
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+}
+
+/*!
+ * \brief Sort \a values in parallel and remove duplicate entries.
+ */
+template <typename T>
+void ParallelSortUnique(std::vector<T>& values, std::size_t num_threads)
+{
+    ParallelSort(values.begin(), values.end(), num_threads);
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+}
@@ -5,6 +5,8 @@
 #include <unordered_set>
 #include <cstdint>
 
+#include "DynamicShortestPath.h"
+
 using Neighbors = std::unordered_map<std::string, uint32_t>;
 using Graph     = std::unordered_map<std::string, Neighbors>;
 using Cost      = std::unordered_map<std::string, uint32_t>;
@@ -81,6 +83,20 @@ ShortestPath(const Graph& network, Cost& costs, Parent& parents)
     }
 }
 
+void
+PrintPath(const Cost& costs, const Parent& parents, const std::string& dst)
+{
+    std::cout << "Shortest Path Cost is = "
+              << costs.find(dst)->second << std::endl;
+    std::cout << "Shortest Path is: ";
+    std::string node = dst;
+    while (parents.find(node) != parents.end()) {
+        std::cout << node << " <- ";
+        node = parents.find(node)->second;
+    }
+    std::cout << node << std::endl;
+}
+
 int main(void)
 {
     /* Initialize the network, cost, and parent tables. */
@@ -97,15 +113,15 @@ int main(void)
     ShortestPath(network, costs, parents);
 
     /* Print out the solution cost and path. */
-    std::cout << "Shortest Path Cost is = "
-              << costs["fin"] << std::endl;
-    std::cout << "Shortest Path is: ";
-    std::string node = "fin";
-    while (parents.find(node) != parents.end()) {
-        std::cout << node << " <- ";
-        node = parents[node];
-    }
-    std::cout << node << std::endl;
+    PrintPath(costs, parents, "fin");
+
+    /* Make the b to fin edge cheaper and repair the paths in place rather
+       than rerunning Dijkstra's algorithm from scratch. */
+    DynamicShortestPath<std::string> dynamic_paths(network, "start");
+    dynamic_paths.SetEdge("b", "fin", 1);
+
+    std::cout << "After Lowering b -> fin to 1:" << std::endl;
+    PrintPath(dynamic_paths.GetCosts(), dynamic_paths.GetParents(), "fin");
 
     return 0;
 }
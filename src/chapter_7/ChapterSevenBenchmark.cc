@@ -0,0 +1,80 @@
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+#include "DynamicShortestPath.h"
+
+using Paths   = DynamicShortestPath<std::uint32_t>;
+using Clock   = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+static const std::uint32_t kNumNodes   = 100000;
+static const std::uint32_t kNumEdges   = 500000;
+static const std::uint32_t kMaxWeight  = 100;
+static const std::size_t   kNumUpdates = 2000;
+static const std::size_t   kNumFull    = 20;
+
+/*!
+ * \brief Build a random network with kNumEdges weighted edges.
+ */
+Paths::Network MakeNetwork(std::mt19937& rng)
+{
+    std::uniform_int_distribution<std::uint32_t> node(0, kNumNodes - 1);
+    std::uniform_int_distribution<std::uint32_t> weight(1, kMaxWeight);
+
+    Paths::Network network;
+    for (std::uint32_t i = 0; i < kNumEdges; ++i)
+        network[node(rng)][node(rng)] = weight(rng);
+
+    return network;
+}
+
+int main(void)
+{
+    std::mt19937 rng(7);
+    Paths paths(MakeNetwork(rng), 0);
+
+    std::uniform_int_distribution<std::uint32_t> node(0, kNumNodes - 1);
+    std::uniform_int_distribution<std::uint32_t> weight(1, kMaxWeight);
+    std::uniform_int_distribution<int>           action(0, 3);
+
+    /* Time a mix of weight increases, weight decreases, insertions and
+       deletions applied incrementally. */
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < kNumUpdates; ++i) {
+        std::uint32_t src = node(rng);
+        const Paths::Neighbors& neighbors = paths.GetNetwork().at(src);
+        if (neighbors.empty() || (0 == action(rng))) {
+            paths.SetEdge(src, node(rng), weight(rng));
+        } else {
+            std::uint32_t dst = neighbors.begin()->first;
+            if (0 == action(rng))
+                paths.EraseEdge(src, dst);
+            else
+                paths.SetEdge(src, dst, weight(rng));
+        }
+    }
+    double incremental = Seconds(Clock::now() - start).count() / kNumUpdates;
+
+    /* Time full recomputations over the same network. */
+    Paths::Cost incremental_costs = paths.GetCosts();
+    start = Clock::now();
+    for (std::size_t i = 0; i < kNumFull; ++i)
+        paths.Recompute();
+    double full = Seconds(Clock::now() - start).count() / kNumFull;
+
+    std::cout << "Nodes = " << kNumNodes << ", Edges = " << kNumEdges
+              << std::endl;
+    std::cout << "Incremental Update Latency = " << incremental * 1e6
+              << " us" << std::endl;
+    std::cout << "Full Recompute Latency = " << full * 1e6
+              << " us" << std::endl;
+    std::cout << "Speedup = " << full / incremental << "x" << std::endl;
+    std::cout << "Incremental Costs Match Full Recompute = "
+              << std::boolalpha << (incremental_costs == paths.GetCosts())
+              << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <queue>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+/*!
+ * \class DynamicShortestPath
+ * \brief Single source shortest paths maintained under edge updates.
+ *
+ * DynamicShortestPath keeps the cost and parent tables produced by
+ * Dijkstra's algorithm and repairs them in place when an edge is inserted,
+ * erased, or reweighted. Following Ramalingam and Reps, only the nodes whose
+ * shortest path actually changes are revisited:
+ *
+ * - A cheaper or new edge seeds a Dijkstra search at its destination that
+ *   stops as soon as costs stop improving.
+ * - A dearer or erased edge only matters if it belongs to the shortest path
+ *   tree. In that case the subtree hanging off the edge is invalidated,
+ *   each invalidated node picks its best parent outside the subtree, and a
+ *   Dijkstra search over the subtree settles the remaining costs.
+ *
+ * After every update the tables match those of a full recomputation. Where
+ * several shortest paths tie, the chosen parent may differ.
+ */
+template <typename T>
+class DynamicShortestPath
+{
+public:
+    using Weight    = std::uint32_t;
+    using Neighbors = std::unordered_map<T, Weight>;
+    using Network   = std::unordered_map<T, Neighbors>;
+    using Cost      = std::unordered_map<T, Weight>;
+    using Parent    = std::unordered_map<T, T>;
+
+    static constexpr Weight
+    kInfinity = std::numeric_limits<Weight>::max(); /*!< Unreachable cost. */
+
+    /*!
+     * \brief Compute the shortest paths from \a source through \a network.
+     */
+    DynamicShortestPath(const Network& network, const T& source);
+
+    ~DynamicShortestPath() = default;
+    DynamicShortestPath(const DynamicShortestPath&) = default;
+    DynamicShortestPath& operator=(const DynamicShortestPath&) = default;
+    DynamicShortestPath(DynamicShortestPath&&) = default;
+    DynamicShortestPath& operator=(DynamicShortestPath&&) = default;
+
+    /*!
+     * \brief Return the cost table.
+     *
+     * Every node in the network has an entry. Unreachable nodes have a cost
+     * of kInfinity.
+     */
+    const Cost&
+    GetCosts() const { return costs_; }
+
+    /*!
+     * \brief Return the parent table.
+     *
+     * Neither the source nor unreachable nodes have an entry.
+     */
+    const Parent&
+    GetParents() const { return parents_; }
+
+    /*!
+     * \brief Return the network the paths are computed over.
+     */
+    const Network&
+    GetNetwork() const { return network_; }
+
+    /*!
+     * \brief Insert the edge \a src to \a dst or change its weight.
+     *
+     * Nodes that are not yet part of the network are added.
+     */
+    void
+    SetEdge(const T& src, const T& dst, Weight weight);
+
+    /*!
+     * \brief Return \c true if the edge \a src to \a dst is deleted.
+     */
+    bool
+    EraseEdge(const T& src, const T& dst);
+
+    /*!
+     * \brief Discard the cost and parent tables and rebuild them from scratch.
+     */
+    void
+    Recompute();
+
+private:
+    using Children = std::unordered_map<T, std::unordered_set<T>>;
+    using Entry    = std::pair<Weight, T>;
+
+    /*!
+     * \brief Min-heap ordering of pending nodes by tentative cost.
+     */
+    struct EntryGreater
+    {
+        bool
+        operator()(const Entry& lhs, const Entry& rhs) const
+            { return (lhs.first > rhs.first); }
+    };
+
+    using Frontier =
+        std::priority_queue<Entry, std::vector<Entry>, EntryGreater>;
+
+    /*!
+     * \brief Add \a node to the network if it does not already exist.
+     */
+    void
+    InsertNode(const T& node);
+
+    /*!
+     * \brief Make \a parent the shortest path predecessor of \a node.
+     */
+    void
+    SetParent(const T& node, const T& parent);
+
+    /*!
+     * \brief Remove \a node's shortest path predecessor.
+     */
+    void
+    ClearParent(const T& node);
+
+    /*!
+     * \brief Lower \a node's cost to \a cost via \a parent if it is cheaper.
+     * \return \c true if \a node's cost changed.
+     */
+    bool
+    Relax(const T& node, const T& parent, Weight cost, Frontier& frontier);
+
+    /*!
+     * \brief Run Dijkstra's algorithm from the nodes in \a frontier.
+     */
+    void
+    Propagate(Frontier& frontier);
+
+    /*!
+     * \brief Repair the tables after the edge into \a node from its parent
+     *        got more expensive or was removed.
+     */
+    void
+    RepairSubtree(const T& node);
+
+    Network  network_;  /*!< Forward adjacency with edge weights. */
+    Network  reverse_;  /*!< Reverse adjacency with edge weights. */
+    T        source_;   /*!< Shortest path source. */
+    Cost     costs_;    /*!< Shortest path cost of every node. */
+    Parent   parents_;  /*!< Shortest path tree predecessors. */
+    Children children_; /*!< Shortest path tree successors. */
+}; // end DynamicShortestPath
+
+template <typename T>
+DynamicShortestPath<T>::DynamicShortestPath(const Network& network,
+                                            const T& source) :
+    source_(source)
+{
+    InsertNode(source);
+    for (const auto& kv : network) {
+        InsertNode(kv.first);
+        for (const auto& neighbor : kv.second) {
+            InsertNode(neighbor.first);
+            network_[kv.first][neighbor.first]  = neighbor.second;
+            reverse_[neighbor.first][kv.first] = neighbor.second;
+        }
+    }
+    Recompute();
+}
+
+template <typename T>
+void
+DynamicShortestPath<T>::InsertNode(const T& node)
+{
+    if (network_.find(node) != network_.end())
+        return;
+
+    network_[node] = {};
+    reverse_[node] = {};
+    costs_[node]   = kInfinity;
+}
+
+template <typename T>
+void
+DynamicShortestPath<T>::SetParent(const T& node, const T& parent)
+{
+    ClearParent(node);
+    parents_[node] = parent;
+    children_[parent].insert(node);
+}
+
+template <typename T>
+void
+DynamicShortestPath<T>::ClearParent(const T& node)
+{
+    auto parent = parents_.find(node);
+    if (parent == parents_.end())
+        return;
+
+    children_[parent->second].erase(node);
+    parents_.erase(parent);
+}
+
+template <typename T>
+bool
+DynamicShortestPath<T>::Relax(const T& node, const T& parent, Weight cost,
+                              Frontier& frontier)
+{
+    if (cost >= costs_[node])
+        return false;
+
+    costs_[node] = cost;
+    SetParent(node, parent);
+    frontier.push({cost, node});
+
+    return true;
+}
+
+template <typename T>
+void
+DynamicShortestPath<T>::Propagate(Frontier& frontier)
+{
+    while (!frontier.empty()) {
+        Entry entry = frontier.top();
+        frontier.pop();
+
+        /* Skip entries made stale by a later, cheaper relaxation. */
+        if (entry.first != costs_[entry.second])
+            continue;
+
+        for (const auto& neighbor : network_[entry.second]) {
+            /* Saturate rather than wrap around on overflow. */
+            Weight new_cost = (neighbor.second > kInfinity - entry.first) ?
+                kInfinity : entry.first + neighbor.second;
+            Relax(neighbor.first, entry.second, new_cost, frontier);
+        }
+    }
+}
+
+template <typename T>
+void
+DynamicShortestPath<T>::Recompute()
+{
+    for (auto& kv : costs_)
+        kv.second = kInfinity;
+    parents_.clear();
+    children_.clear();
+
+    Frontier frontier;
+    costs_[source_] = 0;
+    frontier.push({0, source_});
+    Propagate(frontier);
+}
+
+template <typename T>
+void
+DynamicShortestPath<T>::RepairSubtree(const T& node)
+{
+    /* Invalidate every node whose shortest path ran through the edge. */
+    std::vector<T> affected = {node};
+    for (std::size_t i = 0; i < affected.size(); ++i) {
+        for (const T& child : children_[affected[i]])
+            affected.push_back(child);
+    }
+    for (const T& curr : affected) {
+        costs_[curr] = kInfinity;
+        ClearParent(curr);
+    }
+
+    /* Reattach each invalidated node to its cheapest valid predecessor.
+       Predecessors inside the subtree are still at kInfinity and are
+       handled by the Dijkstra pass that follows. */
+    Frontier frontier;
+    for (const T& curr : affected) {
+        for (const auto& pred : reverse_[curr]) {
+            Weight pred_cost = costs_[pred.first];
+            if ((kInfinity == pred_cost) ||
+                (pred.second >= kInfinity - pred_cost))
+                continue;
+            Relax(curr, pred.first, pred_cost + pred.second, frontier);
+        }
+    }
+    Propagate(frontier);
+}
+
+template <typename T>
+void
+DynamicShortestPath<T>::SetEdge(const T& src, const T& dst, Weight weight)
+{
+    InsertNode(src);
+    InsertNode(dst);
+
+    Neighbors& neighbors = network_[src];
+    auto edge = neighbors.find(dst);
+    bool is_new = (edge == neighbors.end());
+    Weight old_weight = is_new ? kInfinity : edge->second;
+
+    neighbors[dst]      = weight;
+    reverse_[dst][src] = weight;
+
+    if (is_new || (weight < old_weight)) {
+        /* A cheaper edge can only shorten paths through dst. */
+        Weight src_cost = costs_[src];
+        if ((kInfinity == src_cost) || (weight >= kInfinity - src_cost))
+            return;
+
+        Frontier frontier;
+        if (Relax(dst, src, src_cost + weight, frontier))
+            Propagate(frontier);
+    } else if (weight > old_weight) {
+        /* A dearer edge only matters if it is on the shortest path tree. */
+        auto parent = parents_.find(dst);
+        if ((parent != parents_.end()) && (parent->second == src))
+            RepairSubtree(dst);
+    }
+}
+
+template <typename T>
+bool
+DynamicShortestPath<T>::EraseEdge(const T& src, const T& dst)
+{
+    auto neighbors = network_.find(src);
+    if ((neighbors == network_.end()) || !neighbors->second.erase(dst))
+        return false;
+
+    reverse_[dst].erase(src);
+
+    auto parent = parents_.find(dst);
+    if ((parent != parents_.end()) && (parent->second == src))
+        RepairSubtree(dst);
+
+    return true;
+}
@@ -1,12 +1,11 @@
 #include <set>
+#include <chrono>
 #include <string>
 #include <iostream>
 #include <algorithm>
 #include <unordered_map>
 
-using StateSet   = std::set<std::string>;
-using StationSet = StateSet;
-using StationMap = std::unordered_map<std::string, std::set<std::string>>;
+#include "SetCover.h"
 
 std::set<std::string>
 StationSetCoveringSolver(StateSet states_needed,
@@ -62,5 +61,16 @@ int main(void)
         std::cout << station << ' ';
     std::cout << "}" << std::endl;
 
+    /* Search for a provably minimum station set. */
+    ExactSetCoverSolver solver(states_needed, stations);
+    SetCoverResult exact = solver.Solve(std::chrono::seconds(1));
+
+    std::cout << "Exact Solution Station Set = { ";
+    for (const std::string& station : exact.stations)
+        std::cout << station << ' ';
+    std::cout << "}" << std::endl;
+    std::cout << "Optimal = " << std::boolalpha << exact.optimal
+              << ", Gap = " << exact.Gap() << std::endl;
+
     return 0;
 }
@@ -0,0 +1,426 @@
+#pragma once
+
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "WorkStealingPool.h"
+
+using StateSet   = std::set<std::string>;
+using StationSet = StateSet;
+using StationMap = std::unordered_map<std::string, std::set<std::string>>;
+
+/*!
+ * \struct SetCoverResult
+ * \brief The SetCoverResult struct holds the outcome of an exact search.
+ */
+struct SetCoverResult
+{
+    StationSet    stations;    /*!< Best cover found. */
+    StateSet      uncoverable; /*!< Needed states no station covers. */
+    std::size_t   lower_bound; /*!< Proven minimum number of stations. */
+    bool          optimal;     /*!< The search finished within the limit. */
+    std::uint64_t nodes;       /*!< Search tree nodes explored. */
+
+    /*!
+     * \brief Return the relative gap between the cover and the lower bound.
+     *
+     * A gap of 0 means \a stations is a minimum cover.
+     */
+    double
+    Gap() const
+    {
+        if (stations.empty())
+            return 0.0;
+        return static_cast<double>(stations.size() - lower_bound) /
+               stations.size();
+    }
+};
+
+/*!
+ * \class ExactSetCoverSolver
+ * \brief The ExactSetCoverSolver class finds a minimum station set cover.
+ *
+ * States and stations are encoded as bitsets. Before searching, stations
+ * whose coverage is contained in another station's are dropped and the
+ * greedy cover becomes the initial incumbent. The branch and bound search
+ * then picks the uncovered state with the fewest candidate stations and
+ * branches on each of them, excluding the candidates of earlier branches so
+ * that no cover is visited twice. A node is pruned when its stations plus a
+ * lower bound on the stations still needed cannot beat the incumbent. The
+ * lower bound is the larger of a packing of uncovered states no single
+ * station can cover together, which is a feasible solution of the dual of
+ * the covering LP, and the uncovered state count divided by the largest
+ * remaining station.
+ *
+ * The top levels of the search tree are spread over a WorkStealingPool.
+ * If the time limit expires, the best cover found so far is returned along
+ * with the root lower bound so that its optimality gap can be reported.
+ */
+class ExactSetCoverSolver
+{
+public:
+    /*!
+     * \brief Construct a solver for covering \a states_needed.
+     */
+    ExactSetCoverSolver(const StateSet& states_needed,
+                        const StationMap& stations);
+
+    ~ExactSetCoverSolver() = default;
+    ExactSetCoverSolver(const ExactSetCoverSolver&) = delete;
+    ExactSetCoverSolver& operator=(const ExactSetCoverSolver&) = delete;
+    ExactSetCoverSolver(ExactSetCoverSolver&&) = delete;
+    ExactSetCoverSolver& operator=(ExactSetCoverSolver&&) = delete;
+
+    /*!
+     * \brief Search for a minimum cover.
+     *
+     * \param time_limit  Wall clock budget for the search.
+     * \param num_threads Number of search threads.
+     */
+    SetCoverResult
+    Solve(std::chrono::milliseconds time_limit,
+          std::size_t num_threads=std::thread::hardware_concurrency());
+
+private:
+    using Word = std::uint64_t;
+    using Bits = std::vector<Word>;
+
+    /*!
+     * \brief A search tree node.
+     */
+    struct Node
+    {
+        Bits                       covered;  /*!< Covered states. */
+        Bits                       excluded; /*!< Stations ruled out. */
+        std::vector<std::uint32_t> chosen;   /*!< Stations picked so far. */
+    };
+
+    /*! Search tree depth below which children become pool tasks. */
+    static const std::size_t kSplitDepth = 6;
+    /*! Nodes explored between checks of the clock. */
+    static const std::uint64_t kClockInterval = 1024;
+
+    static bool
+    Test(const Bits& bits, std::size_t i)
+        { return (bits[i / 64] >> (i % 64)) & 1; }
+
+    static void
+    Set(Bits& bits, std::size_t i)
+        { bits[i / 64] |= Word(1) << (i % 64); }
+
+    /*!
+     * \brief Return the number of states \a station covers beyond \a covered.
+     */
+    std::size_t
+    Gain(std::size_t station, const Bits& covered) const;
+
+    /*!
+     * \brief Return the stations of a greedy cover.
+     */
+    std::vector<std::uint32_t>
+    GreedyCover() const;
+
+    /*!
+     * \brief Return a lower bound on the stations needed to complete \a node.
+     */
+    std::size_t
+    LowerBound(const Node& node) const;
+
+    /*!
+     * \brief Record \a chosen as the incumbent if it is smaller.
+     */
+    void
+    Offer(const std::vector<std::uint32_t>& chosen);
+
+    /*!
+     * \brief Explore the subtree rooted at \a node.
+     */
+    void
+    Search(Node& node, std::size_t worker);
+
+    std::vector<std::string>   state_names_;   /*!< State index to name. */
+    std::vector<std::string>   station_names_; /*!< Station index to name. */
+    StateSet                   uncoverable_;   /*!< States nobody covers. */
+    std::vector<Bits>          coverage_;      /*!< States per station. */
+    /*! Candidate stations per state, most coverage first. */
+    std::vector<std::vector<std::uint32_t>> candidates_;
+    Bits                       all_states_;    /*!< Every coverable state. */
+    std::size_t                state_words_;   /*!< Words per state bitset. */
+
+    WorkStealingPool*          pool_;          /*!< Pool during Solve(). */
+    std::chrono::steady_clock::time_point deadline_; /*!< Search deadline. */
+    std::atomic<bool>          timed_out_;     /*!< Deadline has passed. */
+    std::atomic<std::uint64_t> nodes_;         /*!< Nodes explored. */
+    std::atomic<std::size_t>   best_size_;     /*!< Incumbent size. */
+    std::mutex                 best_mutex_;    /*!< Guards best_. */
+    std::vector<std::uint32_t> best_;          /*!< Incumbent cover. */
+}; // end ExactSetCoverSolver
+
+inline
+ExactSetCoverSolver::ExactSetCoverSolver(const StateSet& states_needed,
+                                         const StationMap& stations) :
+    pool_(nullptr),
+    timed_out_(false),
+    nodes_(0),
+    best_size_(0)
+{
+    /* Number the states that at least one station covers. */
+    std::unordered_map<std::string, std::uint32_t> state_ids;
+    for (const std::string& state : states_needed) {
+        bool coverable = std::any_of(stations.cbegin(), stations.cend(),
+            [&state](const auto& kv) { return kv.second.count(state) > 0; });
+        if (!coverable) {
+            uncoverable_.insert(state);
+            continue;
+        }
+        state_ids[state] = state_names_.size();
+        state_names_.push_back(state);
+    }
+    state_words_ = (state_names_.size() + 63) / 64;
+
+    std::vector<std::string> names;
+    std::vector<Bits>        coverage;
+    for (const auto& kv : stations) {
+        Bits bits(state_words_, 0);
+        for (const std::string& state : kv.second) {
+            auto id = state_ids.find(state);
+            if (id != state_ids.end())
+                Set(bits, id->second);
+        }
+        names.push_back(kv.first);
+        coverage.push_back(std::move(bits));
+    }
+
+    /* Drop stations dominated by another station: any cover using one can
+       swap it for its dominator. Of identical stations, keep the first. */
+    for (std::size_t s = 0; s < coverage.size(); ++s) {
+        bool dominated = std::all_of(coverage[s].cbegin(), coverage[s].cend(),
+                                     [](Word w) { return 0 == w; });
+        for (std::size_t t = 0; (t < coverage.size()) && !dominated; ++t) {
+            if (s == t)
+                continue;
+            bool subset = true;
+            bool equal  = true;
+            for (std::size_t w = 0; w < state_words_; ++w) {
+                subset = subset && (0 == (coverage[s][w] & ~coverage[t][w]));
+                equal  = equal && (coverage[s][w] == coverage[t][w]);
+            }
+            dominated = subset && (!equal || (t < s));
+        }
+        if (!dominated) {
+            station_names_.push_back(names[s]);
+            coverage_.push_back(coverage[s]);
+        }
+    }
+
+    all_states_.assign(state_words_, 0);
+    candidates_.resize(state_names_.size());
+    for (std::size_t s = 0; s < coverage_.size(); ++s) {
+        for (std::size_t i = 0; i < state_names_.size(); ++i) {
+            if (Test(coverage_[s], i)) {
+                candidates_[i].push_back(s);
+                Set(all_states_, i);
+            }
+        }
+    }
+    Bits none(state_words_, 0);
+    for (auto& list : candidates_) {
+        std::stable_sort(list.begin(), list.end(),
+            [this, &none](std::uint32_t lhs, std::uint32_t rhs)
+                { return Gain(lhs, none) > Gain(rhs, none); });
+    }
+}
+
+inline std::size_t
+ExactSetCoverSolver::Gain(std::size_t station, const Bits& covered) const
+{
+    std::size_t gain = 0;
+    for (std::size_t w = 0; w < state_words_; ++w)
+        gain += __builtin_popcountll(coverage_[station][w] & ~covered[w]);
+    return gain;
+}
+
+inline std::vector<std::uint32_t>
+ExactSetCoverSolver::GreedyCover() const
+{
+    std::vector<std::uint32_t> chosen;
+    Bits covered(state_words_, 0);
+    while (covered != all_states_) {
+        std::size_t best_station = 0;
+        std::size_t best_gain    = 0;
+        for (std::size_t s = 0; s < coverage_.size(); ++s) {
+            std::size_t gain = Gain(s, covered);
+            if (gain > best_gain) {
+                best_station = s;
+                best_gain    = gain;
+            }
+        }
+
+        chosen.push_back(best_station);
+        for (std::size_t w = 0; w < state_words_; ++w)
+            covered[w] |= coverage_[best_station][w];
+    }
+    return chosen;
+}
+
+inline std::size_t
+ExactSetCoverSolver::LowerBound(const Node& node) const
+{
+    /* Uncovered states that share no usable station each need their own
+       station. Visiting the most constrained states first packs more. */
+    std::vector<std::pair<std::size_t, std::uint32_t>> open;
+    std::size_t uncovered = 0;
+    for (std::size_t i = 0; i < state_names_.size(); ++i) {
+        if (Test(node.covered, i))
+            continue;
+        uncovered++;
+
+        std::size_t usable = 0;
+        for (std::uint32_t s : candidates_[i])
+            usable += Test(node.excluded, s) ? 0 : 1;
+        open.push_back({usable, i});
+    }
+    std::sort(open.begin(), open.end());
+
+    Bits        blocked(node.excluded.size(), 0);
+    std::size_t packing = 0;
+    for (const auto& entry : open) {
+        const std::vector<std::uint32_t>& list = candidates_[entry.second];
+        bool independent = std::none_of(list.cbegin(), list.cend(),
+            [&](std::uint32_t s)
+                { return !Test(node.excluded, s) && Test(blocked, s); });
+        if (!independent)
+            continue;
+
+        packing++;
+        for (std::uint32_t s : list)
+            Set(blocked, s);
+    }
+
+    /* Even the largest usable station covers a bounded number of states. */
+    std::size_t max_gain = 0;
+    for (std::size_t s = 0; s < coverage_.size(); ++s) {
+        if (!Test(node.excluded, s))
+            max_gain = std::max(max_gain, Gain(s, node.covered));
+    }
+    std::size_t volume = (0 == max_gain) ?
+        uncovered : (uncovered + max_gain - 1) / max_gain;
+
+    return std::max(packing, volume);
+}
+
+inline void
+ExactSetCoverSolver::Offer(const std::vector<std::uint32_t>& chosen)
+{
+    std::lock_guard<std::mutex> lock(best_mutex_);
+    if (chosen.size() < best_.size()) {
+        best_ = chosen;
+        best_size_.store(chosen.size());
+    }
+}
+
+inline void
+ExactSetCoverSolver::Search(Node& node, std::size_t worker)
+{
+    if (timed_out_.load(std::memory_order_relaxed))
+        return;
+    if ((0 == nodes_.fetch_add(1, std::memory_order_relaxed) %
+              kClockInterval) &&
+        (std::chrono::steady_clock::now() >= deadline_)) {
+        timed_out_.store(true);
+        return;
+    }
+
+    if (node.covered == all_states_) {
+        Offer(node.chosen);
+        return;
+    }
+
+    /* Only nodes that can still beat the incumbent are explored. */
+    if (node.chosen.size() + LowerBound(node) >= best_size_.load())
+        return;
+
+    /* Branch on the uncovered state with the fewest usable stations. */
+    std::size_t branch_state = 0;
+    std::size_t fewest       = static_cast<std::size_t>(-1);
+    for (std::size_t i = 0; i < state_names_.size(); ++i) {
+        if (Test(node.covered, i))
+            continue;
+
+        std::size_t usable = 0;
+        for (std::uint32_t s : candidates_[i])
+            usable += Test(node.excluded, s) ? 0 : 1;
+        if (usable < fewest) {
+            branch_state = i;
+            fewest       = usable;
+        }
+    }
+
+    /* Every cover of this node uses one of the branch state's stations.
+       Branch k uses the k-th station and excludes the earlier ones. */
+    Bits excluded = node.excluded;
+    for (std::uint32_t s : candidates_[branch_state]) {
+        if (Test(excluded, s))
+            continue;
+
+        Node child{node.covered, excluded, node.chosen};
+        for (std::size_t w = 0; w < state_words_; ++w)
+            child.covered[w] |= coverage_[s][w];
+        child.chosen.push_back(s);
+        Set(excluded, s);
+
+        if (pool_ && (node.chosen.size() < kSplitDepth)) {
+            pool_->Submit([this, child](std::size_t w) mutable
+                              { Search(child, w); },
+                          worker);
+        } else {
+            Search(child, worker);
+        }
+    }
+}
+
+inline SetCoverResult
+ExactSetCoverSolver::Solve(std::chrono::milliseconds time_limit,
+                           std::size_t num_threads)
+{
+    deadline_ = std::chrono::steady_clock::now() + time_limit;
+    timed_out_.store(false);
+    nodes_.store(0);
+
+    best_ = GreedyCover();
+    best_size_.store(best_.size());
+
+    Node root{Bits(state_words_, 0),
+              Bits((coverage_.size() + 63) / 64, 0),
+              {}};
+    std::size_t root_bound = LowerBound(root);
+
+    /* The greedy cover is already optimal if it meets the bound. */
+    if (best_.size() > root_bound) {
+        WorkStealingPool pool(std::max<std::size_t>(1, num_threads));
+        pool_ = (pool.Size() > 1) ? &pool : nullptr;
+        pool.Submit([this, &root](std::size_t w) { Search(root, w); }, 0);
+        pool.Run();
+        pool_ = nullptr;
+    }
+
+    SetCoverResult result;
+    for (std::uint32_t s : best_)
+        result.stations.insert(station_names_[s]);
+    result.uncoverable = uncoverable_;
+    result.optimal     = !timed_out_.load();
+    result.lower_bound = result.optimal ? best_.size() : root_bound;
+    result.nodes       = nodes_.load();
+
+    return result;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
+
+/*!
+ * \class WorkStealingPool
+ * \brief The WorkStealingPool class runs recursively spawned tasks.
+ *
+ * Every worker owns a deque of tasks. A worker pushes the tasks it spawns
+ * onto the back of its own deque and pops from the back as well, so it works
+ * depth first on the subproblem it just created. An idle worker steals from
+ * the front of another worker's deque, taking the oldest and usually largest
+ * piece of outstanding work.
+ */
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void(std::size_t worker)>;
+
+    /*!
+     * \brief Construct a pool with \a num_threads workers.
+     */
+    explicit WorkStealingPool(std::size_t num_threads);
+
+    ~WorkStealingPool() = default;
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    WorkStealingPool(WorkStealingPool&&) = delete;
+    WorkStealingPool& operator=(WorkStealingPool&&) = delete;
+
+    /*!
+     * \brief Return the number of workers.
+     */
+    std::size_t
+    Size() const { return queues_.size(); }
+
+    /*!
+     * \brief Queue \a task on \a worker's deque.
+     *
+     * Tasks call Submit() with the worker id they were given to spawn
+     * subtasks. Before Run(), any worker id may be used.
+     */
+    void
+    Submit(Task task, std::size_t worker);
+
+    /*!
+     * \brief Run queued tasks until every task, including the ones they
+     *        spawn, has finished.
+     */
+    void
+    Run();
+
+private:
+    /*!
+     * \brief A worker's task deque.
+     */
+    struct Queue
+    {
+        std::mutex       mutex; /*!< Guards tasks. */
+        std::deque<Task> tasks; /*!< Pending tasks, newest at the back. */
+    };
+
+    /*!
+     * \brief Take the newest task from \a worker's own deque.
+     */
+    bool
+    TryPop(std::size_t worker, Task& task);
+
+    /*!
+     * \brief Take the oldest task from another worker's deque.
+     */
+    bool
+    TrySteal(std::size_t thief, Task& task);
+
+    /*!
+     * \brief Main loop of \a worker.
+     */
+    void
+    Work(std::size_t worker);
+
+    std::vector<std::unique_ptr<Queue>> queues_;  /*!< One deque per worker. */
+    std::atomic<std::size_t>            pending_; /*!< Unfinished tasks. */
+}; // end WorkStealingPool
+
+inline
+WorkStealingPool::WorkStealingPool(std::size_t num_threads) :
+    pending_(0)
+{
+    for (std::size_t i = 0; i < std::max<std::size_t>(1, num_threads); ++i)
+        queues_.push_back(std::make_unique<Queue>());
+}
+
+inline void
+WorkStealingPool::Submit(Task task, std::size_t worker)
+{
+    /* Count the task before publishing it so that pending_ cannot reach
+       zero while a parent task is still spawning children. */
+    pending_.fetch_add(1);
+
+    Queue& queue = *queues_[worker % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+}
+
+inline bool
+WorkStealingPool::TryPop(std::size_t worker, Task& task)
+{
+    Queue& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+inline bool
+WorkStealingPool::TrySteal(std::size_t thief, Task& task)
+{
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+        Queue& queue = *queues_[(thief + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+inline void
+WorkStealingPool::Work(std::size_t worker)
+{
+    Task task;
+    while (pending_.load() > 0) {
+        if (TryPop(worker, task) || TrySteal(worker, task)) {
+            task(worker);
+            task = nullptr;
+            pending_.fetch_sub(1);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+inline void
+WorkStealingPool::Run()
+{
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < queues_.size(); ++i)
+        workers.emplace_back(&WorkStealingPool::Work, this, i);
+    Work(0);
+    for (std::thread& worker : workers)
+        worker.join();
+}
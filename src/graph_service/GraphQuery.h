@@ -0,0 +1,455 @@
+#pragma once
+
+#include <queue>
+#include <string>
+#include <vector>
+#include <limits>
+#include <sstream>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "Graph.h"
+#include "CompactGraph.h"
+#include "GraphOrdering.h"
+#include "MultiSourceBfs.h"
+
+/*!
+ * \brief Kinds of requests understood by the graph service.
+ *
+ * Requests and responses are single lines of text. Every request starts
+ * with a client chosen tag that is echoed at the start of its response, so a
+ * client may pipeline many requests and match the responses, which can
+ * arrive in any order.
+ *
+ *     <tag> REACH <source> <target>  ->  <tag> OK 1|0
+ *     <tag> SEARCH <source> <k>      ->  <tag> OK <node> <distance> | OK -
+ *     <tag> PATH <source> <target>   ->  <tag> OK <cost> <node>... | OK -
+ *     <tag> INFO                     ->  <tag> OK <nodes> <edges> <max node>
+ *     <tag> STATS                    ->  <tag> OK <latency summary>
+ *
+ * SEARCH finds the nearest node reachable from source whose label is a
+ * multiple of k. Failed requests are answered with <tag> ERR <reason>.
+ */
+enum class QueryType
+{
+    kReach,
+    kSearch,
+    kPath,
+    kInfo,
+    kStats,
+};
+
+/*! Number of query types that run on the worker pool. */
+static const std::size_t kNumGraphQueryTypes = 3;
+
+/*!
+ * \struct Query
+ * \brief The Query struct holds one parsed request.
+ */
+struct Query
+{
+    std::uint64_t tag    = 0;                 /*!< Client chosen tag. */
+    QueryType     type   = QueryType::kInfo;  /*!< Kind of request. */
+    std::uint32_t source = 0;                 /*!< Start node. */
+    std::uint32_t target = 0;                 /*!< Target node or k. */
+};
+
+/*!
+ * \brief Return the protocol name of \a type.
+ */
+inline const char*
+QueryName(QueryType type)
+{
+    switch (type) {
+    case QueryType::kReach:  return "REACH";
+    case QueryType::kSearch: return "SEARCH";
+    case QueryType::kPath:   return "PATH";
+    case QueryType::kInfo:   return "INFO";
+    case QueryType::kStats:  return "STATS";
+    }
+    return "";
+}
+
+/*!
+ * \brief Parse the request \a line into \a query.
+ *
+ * \return \c false if \a line is malformed. \a query.tag is still set if
+ *         the tag itself could be read.
+ */
+inline bool
+ParseQuery(const std::string& line, Query& query)
+{
+    std::istringstream stream(line);
+    std::string        name;
+    if (!(stream >> query.tag >> name))
+        return false;
+
+    static const QueryType kTypes[] = {
+        QueryType::kReach, QueryType::kSearch, QueryType::kPath,
+        QueryType::kInfo, QueryType::kStats,
+    };
+    for (QueryType type : kTypes) {
+        if (name != QueryName(type))
+            continue;
+
+        query.type = type;
+        if ((QueryType::kInfo == type) || (QueryType::kStats == type))
+            return true;
+        if (!(stream >> query.source >> query.target))
+            return false;
+        return ((QueryType::kSearch != type) || (0 != query.target));
+    }
+    return false;
+}
+
+/*!
+ * \brief Return the request line for \a query, without the newline.
+ */
+inline std::string
+FormatQuery(const Query& query)
+{
+    std::string line = std::to_string(query.tag) + " " +
+                       QueryName(query.type);
+    if ((QueryType::kInfo != query.type) && (QueryType::kStats != query.type))
+        line += " " + std::to_string(query.source) + " " +
+                std::to_string(query.target);
+    return line;
+}
+
+/*!
+ * \class QueryEngine
+ * \brief The QueryEngine class answers graph queries against a weighted,
+ *        directed graph loaded once.
+ *
+ * The graph is stored as a CompactGraph relabeled with Reverse
+ * Cuthill-McKee, with edge weights in an array parallel to its neighbor
+ * lists. Execute() answers a whole batch at once: SEARCH queries that share
+ * k are run together through MultiSourceBfs, while REACH and PATH queries
+ * run one by one. All methods are const and may be called concurrently,
+ * each caller passing its own Scratch space.
+ */
+class QueryEngine
+{
+public:
+    using Weight = std::uint32_t;
+    using Cost   = std::uint64_t;
+    using Id     = CompactGraph<std::uint32_t>::Id;
+
+    /*!
+     * \struct WeightedEdge
+     * \brief The WeightedEdge struct describes one input edge.
+     */
+    struct WeightedEdge
+    {
+        std::uint32_t source; /*!< Tail of the edge. */
+        std::uint32_t target; /*!< Head of the edge. */
+        Weight        weight; /*!< Cost of the edge. */
+    };
+
+    /*!
+     * \class Scratch
+     * \brief Per-thread working memory for REACH, PATH and SEARCH queries.
+     *
+     * Only the entries touched by a query are reset afterwards, so a query
+     * costs time proportional to the part of the graph it explores rather
+     * than to the size of the graph.
+     */
+    class Scratch
+    {
+    private:
+        friend class QueryEngine;
+
+        std::vector<Cost> cost;    /*!< Best known cost per node. */
+        std::vector<Id>   parent;  /*!< Predecessor on the best path. */
+        std::vector<Id>   touched; /*!< Nodes whose cost was set. */
+        std::vector<Id>   queue;   /*!< BFS queue. */
+
+        MultiSourceBfs<std::uint32_t>::Scratch search; /*!< SEARCH masks. */
+    };
+
+    /*!
+     * \brief Load the graph made of \a edges.
+     *
+     * Of several edges between the same nodes, the cheapest one is kept.
+     */
+    explicit QueryEngine(const std::vector<WeightedEdge>& edges);
+
+    /*!
+     * \brief Return the number of nodes.
+     */
+    std::size_t
+    Size() const { return Compact().Size(); }
+
+    /*!
+     * \brief Return the number of edges.
+     */
+    std::size_t
+    EdgeCount() const { return Compact().EdgeCount(); }
+
+    /*!
+     * \brief Return the largest node label.
+     */
+    std::uint32_t
+    MaxNode() const { return max_node_; }
+
+    /*!
+     * \brief Answer every REACH, SEARCH and PATH query in \a batch.
+     *
+     * \return The response lines, without newlines, in the order of
+     *         \a batch.
+     */
+    std::vector<std::string>
+    Execute(const std::vector<Query>& batch, Scratch& scratch) const;
+
+private:
+    static constexpr Cost kInfinity = std::numeric_limits<Cost>::max();
+
+    const CompactGraph<std::uint32_t>&
+    Compact() const { return search_.GetGraph(); }
+
+    /*!
+     * \brief Answer a REACH query with a breadth first search.
+     */
+    std::string
+    Reach(const Query& query, Scratch& scratch) const;
+
+    /*!
+     * \brief Answer a PATH query with Dijkstra's algorithm, stopping as soon
+     *        as the target is settled.
+     */
+    std::string
+    Path(const Query& query, Scratch& scratch) const;
+
+    /*!
+     * \brief Size \a scratch for this graph and mark every node unvisited.
+     */
+    void
+    Prepare(Scratch& scratch) const;
+
+    /*!
+     * \brief Mark every node touched by the last query unvisited again.
+     */
+    static void
+    Reset(Scratch& scratch);
+
+    MultiSourceBfs<std::uint32_t> search_;   /*!< Graph and batched BFS. */
+    std::vector<Weight>           weights_;  /*!< Weight of every edge. */
+    std::uint32_t                 max_node_; /*!< Largest node label. */
+}; // end QueryEngine
+
+/*!
+ * \brief Build the relabeled CompactGraph for the edges in \a edges.
+ */
+inline CompactGraph<std::uint32_t>
+MakeQueryGraph(const std::vector<QueryEngine::WeightedEdge>& edges)
+{
+    using Network = Graph<std::uint32_t, false>;
+
+    std::vector<Network::Edge> pairs;
+    pairs.reserve(edges.size());
+    for (const QueryEngine::WeightedEdge& edge : edges)
+        pairs.emplace_back(edge.source, edge.target);
+
+    CompactGraph<std::uint32_t> hashed(Network::BulkLoad(std::move(pairs)));
+    return CompactGraph<std::uint32_t>(hashed, ReverseCuthillMcKee(hashed));
+}
+
+inline
+QueryEngine::QueryEngine(const std::vector<WeightedEdge>& edges) :
+    search_(MakeQueryGraph(edges)),
+    max_node_(0)
+{
+    const CompactGraph<std::uint32_t>& graph = Compact();
+
+    /* Keep the cheapest weight of every edge, keyed by its ids. */
+    std::unordered_map<std::uint64_t, Weight> cheapest;
+    cheapest.reserve(edges.size());
+    for (const WeightedEdge& edge : edges) {
+        Id source = 0;
+        Id target = 0;
+        graph.Find(edge.source, source);
+        graph.Find(edge.target, target);
+
+        auto key = (std::uint64_t(source) << 32) | target;
+        auto it  = cheapest.emplace(key, edge.weight).first;
+        it->second = std::min(it->second, edge.weight);
+        max_node_  = std::max({max_node_, edge.source, edge.target});
+    }
+
+    weights_.resize(graph.EdgeCount());
+    for (Id u = 0; u < graph.Size(); ++u) {
+        std::size_t i = graph.EdgeOffset(u);
+        for (Id v : graph.GetNeighbors(u))
+            weights_[i++] = cheapest[(std::uint64_t(u) << 32) | v];
+    }
+}
+
+inline std::vector<std::string>
+QueryEngine::Execute(const std::vector<Query>& batch, Scratch& scratch) const
+{
+    std::vector<std::string> responses(batch.size());
+    Prepare(scratch);
+
+    /* Group SEARCH queries by k so each group shares one batched BFS. */
+    std::unordered_map<std::uint32_t, std::vector<std::size_t>> searches;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        const Query& query = batch[i];
+        std::string  tag   = std::to_string(query.tag) + " ";
+        Id           id    = 0;
+        if (!Compact().Find(query.source, id) ||
+            ((QueryType::kSearch != query.type) &&
+             !Compact().Find(query.target, id))) {
+            responses[i] = tag + "ERR unknown node";
+            continue;
+        }
+
+        switch (query.type) {
+        case QueryType::kReach:
+            responses[i] = tag + Reach(query, scratch);
+            break;
+        case QueryType::kPath:
+            responses[i] = tag + Path(query, scratch);
+            break;
+        case QueryType::kSearch:
+            searches[query.target].push_back(i);
+            break;
+        default:
+            responses[i] = tag + "ERR unsupported request";
+            break;
+        }
+    }
+
+    for (const auto& group : searches) {
+        std::uint32_t              k = group.first;
+        std::vector<std::uint32_t> sources;
+        for (std::size_t i : group.second)
+            sources.push_back(batch[i].source);
+
+        std::vector<BfsHit<std::uint32_t>> hits = search_.Search(
+            sources, [k](std::uint32_t node) { return (0 == node % k); },
+            scratch.search);
+        for (std::size_t j = 0; j < hits.size(); ++j) {
+            std::string& response = responses[group.second[j]];
+            response = std::to_string(batch[group.second[j]].tag) + " OK ";
+            if (hits[j].found)
+                response += std::to_string(hits[j].node) + " " +
+                            std::to_string(hits[j].distance);
+            else
+                response += "-";
+        }
+    }
+
+    return responses;
+}
+
+inline void
+QueryEngine::Prepare(Scratch& scratch) const
+{
+    if (scratch.cost.size() != Size()) {
+        scratch.cost.assign(Size(), kInfinity);
+        scratch.parent.assign(Size(), 0);
+        scratch.queue.resize(Size());
+        scratch.touched.clear();
+    }
+}
+
+inline void
+QueryEngine::Reset(Scratch& scratch)
+{
+    for (Id id : scratch.touched)
+        scratch.cost[id] = kInfinity;
+    scratch.touched.clear();
+}
+
+inline std::string
+QueryEngine::Reach(const Query& query, Scratch& scratch) const
+{
+    const CompactGraph<std::uint32_t>& graph = Compact();
+
+    Id source = 0;
+    Id target = 0;
+    graph.Find(query.source, source);
+    graph.Find(query.target, target);
+
+    std::size_t head = 0;
+    std::size_t tail = 0;
+    bool        found = (source == target);
+    scratch.cost[source] = 0;
+    scratch.touched.push_back(source);
+    scratch.queue[tail++] = source;
+    while (!found && (head < tail)) {
+        Id u = scratch.queue[head++];
+        for (Id v : graph.GetNeighbors(u)) {
+            if (kInfinity != scratch.cost[v])
+                continue;
+
+            scratch.cost[v] = 0;
+            scratch.touched.push_back(v);
+            scratch.queue[tail++] = v;
+            if (v == target) {
+                found = true;
+                break;
+            }
+        }
+    }
+
+    Reset(scratch);
+    return found ? "OK 1" : "OK 0";
+}
+
+inline std::string
+QueryEngine::Path(const Query& query, Scratch& scratch) const
+{
+    using Entry = std::pair<Cost, Id>;
+
+    const CompactGraph<std::uint32_t>& graph = Compact();
+
+    Id source = 0;
+    Id target = 0;
+    graph.Find(query.source, source);
+    graph.Find(query.target, target);
+
+    /* Lazy deletion heap, stale entries are skipped when popped. */
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    scratch.cost[source] = 0;
+    scratch.touched.push_back(source);
+    heap.emplace(0, source);
+    while (!heap.empty()) {
+        Entry top = heap.top();
+        heap.pop();
+        if (top.first != scratch.cost[top.second])
+            continue;
+        if (top.second == target)
+            break;
+
+        std::size_t i = graph.EdgeOffset(top.second);
+        for (Id v : graph.GetNeighbors(top.second)) {
+            Cost cost = top.first + weights_[i++];
+            if (cost >= scratch.cost[v])
+                continue;
+
+            if (kInfinity == scratch.cost[v])
+                scratch.touched.push_back(v);
+            scratch.cost[v]   = cost;
+            scratch.parent[v] = top.second;
+            heap.emplace(cost, v);
+        }
+    }
+
+    std::string response = "OK -";
+    if (kInfinity != scratch.cost[target]) {
+        std::vector<Id> path = {target};
+        while (path.back() != source)
+            path.push_back(scratch.parent[path.back()]);
+
+        response = "OK " + std::to_string(scratch.cost[target]);
+        for (auto it = path.rbegin(); it != path.rend(); ++it)
+            response += " " + std::to_string(graph.GetNode(*it));
+    }
+
+    Reset(scratch);
+    return response;
+}
@@ -0,0 +1,214 @@
+#include <random>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <charconv>
+#include <algorithm>
+#include <unordered_map>
+#include <sstream>
+#include <iostream>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+
+#include <unistd.h>
+
+#include "GraphQuery.h"
+#include "QueryServer.h"
+
+using Clock   = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+static const char*         kDefaultSocket = "/tmp/graph_service.sock";
+static const std::uint32_t kDefaultScale  = 16;
+static const std::uint32_t kRmatDegree    = 8;
+static const std::uint32_t kMaxWeight     = 100;
+static const int           kMaxThreads    = 1024;
+static const int           kMaxBatch      = 1 << 16;
+
+static QueryServer* g_server = nullptr;
+
+void HandleSignal(int)
+{
+    if (g_server)
+        g_server->Stop();
+}
+
+void Usage()
+{
+    std::cout << "usage: graph_service [OPTION]..." << std::endl;
+    std::cout << "options:" << std::endl;
+    std::cout << "\t-s PATH  Unix socket to listen on (default "
+              << kDefaultSocket << ")." << std::endl;
+    std::cout << "\t-g FILE  Load 'source target [weight]' edge lines from "
+              << "FILE." << std::endl;
+    std::cout << "\t-n SCALE Without -g, generate an R-MAT graph with "
+              << "2^SCALE nodes (default " << kDefaultScale << ")."
+              << std::endl;
+    std::cout << "\t-t N     Worker threads (default: all cores)."
+              << std::endl;
+    std::cout << "\t-b N     Largest batch handed to a worker (default 256)."
+              << std::endl;
+    std::cout << "\t-h       Print this help message." << std::endl;
+}
+
+/*!
+ * \brief Parse all of \a token as an unsigned 32-bit number.
+ *
+ * \return \c false if \a token holds anything else, including a sign, or
+ *         the number is out of range.
+ */
+bool ParseNumber(const std::string& token, std::uint32_t& value)
+{
+    const char* last   = token.data() + token.size();
+    auto        result = std::from_chars(token.data(), last, value);
+    return (std::errc() == result.ec) && (last == result.ptr);
+}
+
+/*!
+ * \brief Read the edge list in \a path into \a edges.
+ *
+ * Every line holds a source, a target and an optional weight, which
+ * defaults to 1, all unsigned 32-bit numbers. Empty lines and lines
+ * starting with '#' are skipped.
+ *
+ * \return \c false if the file cannot be read or a line is malformed.
+ */
+bool ReadEdges(const std::string& path,
+               std::vector<QueryEngine::WeightedEdge>& edges)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || ('#' == line[0]))
+            continue;
+
+        std::istringstream       stream(line);
+        std::vector<std::string> fields;
+        std::string              field;
+        while (stream >> field)
+            fields.push_back(field);
+
+        QueryEngine::WeightedEdge edge = {0, 0, 1};
+        if ((fields.size() < 2) || (fields.size() > 3) ||
+            !ParseNumber(fields[0], edge.source) ||
+            !ParseNumber(fields[1], edge.target) ||
+            ((3 == fields.size()) && !ParseNumber(fields[2], edge.weight)))
+            return false;
+        edges.push_back(edge);
+    }
+
+    return !file.bad();
+}
+
+/*!
+ * \brief Generate a skewed, social network shaped R-MAT graph with
+ *        2^\a scale nodes and random weights.
+ */
+std::vector<QueryEngine::WeightedEdge> MakeRmat(std::uint32_t scale)
+{
+    std::mt19937                                 rng(7);
+    std::uniform_real_distribution<double>       coin(0.0, 1.0);
+    std::uniform_int_distribution<std::uint32_t> weight(1, kMaxWeight);
+
+    std::vector<QueryEngine::WeightedEdge> edges;
+    while (edges.size() < (std::size_t(1) << scale) * kRmatDegree) {
+        std::uint32_t src = 0;
+        std::uint32_t dst = 0;
+        for (std::uint32_t bit = 0; bit < scale; ++bit) {
+            double p = coin(rng);
+            src = (src << 1) | ((p >= 0.76) ? 1 : 0);
+            dst = (dst << 1) | (((p >= 0.57) && (p < 0.76)) ||
+                                (p >= 0.95) ? 1 : 0);
+        }
+        if (src != dst)
+            edges.push_back({src, dst, weight(rng)});
+    }
+
+    /* Number the nodes that have edges 0 to n - 1, so that clients can
+       pick existing nodes at random. */
+    std::unordered_map<std::uint32_t, std::uint32_t> labels;
+    for (QueryEngine::WeightedEdge& edge : edges) {
+        for (std::uint32_t* node : {&edge.source, &edge.target}) {
+            auto size = static_cast<std::uint32_t>(labels.size());
+            *node = labels.emplace(*node, size).first->second;
+        }
+    }
+
+    return edges;
+}
+
+int main(int argc, char** argv)
+{
+    QueryServerOptions options;
+    options.socket_path = kDefaultSocket;
+    options.num_threads = std::thread::hardware_concurrency();
+
+    std::string   graph_path;
+    std::uint32_t scale = kDefaultScale;
+
+    int flag;
+    while (-1 != (flag = getopt(argc, argv, "s:g:n:t:b:h"))) {
+        switch (flag) {
+        case 's': options.socket_path = optarg; break;
+        case 'g': graph_path = optarg; break;
+        case 'n': scale = std::clamp(std::atoi(optarg), 1, 30); break;
+        case 't':
+            options.num_threads = std::clamp(std::atoi(optarg), 1,
+                                             kMaxThreads);
+            break;
+        case 'b':
+            options.max_batch = std::clamp(std::atoi(optarg), 1, kMaxBatch);
+            break;
+        default:
+            Usage();
+            return ('h' == flag) ? 0 : 1;
+        }
+    }
+
+    Clock::time_point start = Clock::now();
+    std::vector<QueryEngine::WeightedEdge> edges;
+    if (graph_path.empty()) {
+        edges = MakeRmat(scale);
+    } else if (!ReadEdges(graph_path, edges)) {
+        std::cerr << "Failed to read the graph in " << graph_path
+                  << std::endl;
+        return 1;
+    }
+    QueryEngine engine(edges);
+    edges = {};
+
+    std::cout << "Loaded " << engine.Size() << " nodes and "
+              << engine.EdgeCount() << " edges in "
+              << Seconds(Clock::now() - start).count() << " s" << std::endl;
+
+    QueryServer server(engine, options);
+    if (!server.Listen()) {
+        std::cerr << "Failed to listen on " << options.socket_path << ": "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    g_server = &server;
+    std::signal(SIGINT, HandleSignal);
+    std::signal(SIGTERM, HandleSignal);
+
+    std::cout << "Listening on " << options.socket_path << std::endl;
+    bool ok = server.Run();
+    g_server = nullptr;
+    if (!ok) {
+        std::cerr << "Event loop failed: " << std::strerror(errno)
+                  << std::endl;
+    }
+
+    std::cout << server.Stats() << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+
+#include "GraphQuery.h"
+#include "LatencyHistogram.h"
+
+using Clock   = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+static const char*         kDefaultSocket = "/tmp/graph_service.sock";
+static const std::uint32_t kSearchDivisor = 1000;
+
+/*!
+ * \struct LoadOptions
+ * \brief The LoadOptions struct configures a load test.
+ */
+struct LoadOptions
+{
+    std::string socket_path = kDefaultSocket; /*!< Service socket. */
+    std::size_t connections = 4;              /*!< Concurrent clients. */
+    std::size_t depth       = 32;             /*!< Pipelined per client. */
+    double      duration    = 5.0;            /*!< Seconds of load. */
+};
+
+/*!
+ * \struct LoadResults
+ * \brief The LoadResults struct collects the measurements of all clients.
+ */
+struct LoadResults
+{
+    std::array<LatencyHistogram, kNumGraphQueryTypes> latency; /*!< In ns. */
+    std::atomic<std::uint64_t> errors{0}; /*!< ERR responses. */
+    std::atomic<bool>          failed{false}; /*!< A connection broke. */
+};
+
+void Usage()
+{
+    std::cout << "usage: graph_service_load [OPTION]..." << std::endl;
+    std::cout << "options:" << std::endl;
+    std::cout << "\t-s PATH  Service socket (default " << kDefaultSocket
+              << ")." << std::endl;
+    std::cout << "\t-c N     Concurrent connections (default 4)."
+              << std::endl;
+    std::cout << "\t-d N     Requests in flight per connection (default 32)."
+              << std::endl;
+    std::cout << "\t-t SECS  Duration of the test (default 5)." << std::endl;
+    std::cout << "\t-h       Print this help message." << std::endl;
+}
+
+/*!
+ * \class LineSocket
+ * \brief The LineSocket class sends and receives lines over a blocking
+ *        Unix socket.
+ */
+class LineSocket
+{
+public:
+    LineSocket() : fd_(-1) { }
+    ~LineSocket() { if (fd_ >= 0) close(fd_); }
+    LineSocket(const LineSocket&) = delete;
+    LineSocket& operator=(const LineSocket&) = delete;
+
+    /*!
+     * \brief Connect to the socket at \a path.
+     */
+    bool
+    Connect(const std::string& path)
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            return false;
+        std::strcpy(address.sun_path, path.c_str());
+
+        fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        return (fd_ >= 0) &&
+               (0 == connect(fd_, reinterpret_cast<sockaddr*>(&address),
+                             sizeof(address)));
+    }
+
+    /*!
+     * \brief Send all of \a data.
+     */
+    bool
+    Send(const std::string& data)
+    {
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t size = send(fd_, data.data() + sent, data.size() - sent,
+                                MSG_NOSIGNAL);
+            if ((size < 0) && (EINTR == errno))
+                continue;
+            if (size <= 0)
+                return false;
+            sent += size;
+        }
+        return true;
+    }
+
+    /*!
+     * \brief Wait for the next line and store it in \a line without its
+     *        newline.
+     */
+    bool
+    Receive(std::string& line)
+    {
+        std::size_t end;
+        while (std::string::npos == (end = buffer_.find('\n', start_))) {
+            buffer_.erase(0, start_);
+            start_ = 0;
+
+            char    chunk[1 << 16];
+            ssize_t size = recv(fd_, chunk, sizeof(chunk), 0);
+            if ((size < 0) && (EINTR == errno))
+                continue;
+            if (size <= 0)
+                return false;
+            buffer_.append(chunk, size);
+        }
+
+        line.assign(buffer_, start_, end - start_);
+        start_ = end + 1;
+        return true;
+    }
+
+private:
+    int         fd_;        /*!< Connected socket. */
+    std::string buffer_;    /*!< Received bytes. */
+    std::size_t start_ = 0; /*!< Start of the next line in buffer_. */
+};
+
+/*!
+ * \brief Keep \a options.depth random queries in flight on one connection
+ *        until the test ends, recording every response's latency.
+ */
+void RunClient(const LoadOptions& options, std::size_t index,
+               std::uint32_t max_node, Clock::time_point deadline,
+               LoadResults& results)
+{
+    LineSocket socket;
+    if (!socket.Connect(options.socket_path)) {
+        results.failed.store(true);
+        return;
+    }
+
+    std::mt19937                                 rng(index + 1);
+    std::uniform_int_distribution<std::uint32_t> node(0, max_node);
+    std::uniform_int_distribution<int>           kind(0, 3);
+
+    /* Half of the load is SEARCH, the rest is split between REACH and
+       PATH. */
+    auto next_query = [&](std::uint64_t tag) {
+        Query query;
+        query.tag    = tag;
+        query.source = node(rng);
+        switch (kind(rng)) {
+        case 0:
+            query.type   = QueryType::kReach;
+            query.target = node(rng);
+            break;
+        case 1:
+            query.type   = QueryType::kPath;
+            query.target = node(rng);
+            break;
+        default:
+            query.type   = QueryType::kSearch;
+            query.target = kSearchDivisor;
+            break;
+        }
+        return query;
+    };
+
+    using Sent = std::pair<Clock::time_point, QueryType>;
+    std::unordered_map<std::uint64_t, Sent> in_flight;
+    std::uint64_t tag = std::uint64_t(index) << 40;
+    std::string   requests;
+    std::string   line;
+    for (;;) {
+        requests.clear();
+        Clock::time_point now = Clock::now();
+        while ((now < deadline) && (in_flight.size() < options.depth)) {
+            Query query = next_query(++tag);
+            requests += FormatQuery(query) + "\n";
+            in_flight.emplace(query.tag, Sent(now, query.type));
+        }
+        if (in_flight.empty())
+            break;
+        if (!requests.empty() && !socket.Send(requests)) {
+            results.failed.store(true);
+            return;
+        }
+
+        if (!socket.Receive(line)) {
+            results.failed.store(true);
+            return;
+        }
+        std::uint64_t response_tag = std::strtoull(line.c_str(), nullptr, 10);
+        auto          it           = in_flight.find(response_tag);
+        if (it == in_flight.end())
+            continue;
+
+        auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - it->second.first).count();
+        results.latency[static_cast<std::size_t>(it->second.second)]
+            .Record(latency);
+        if (std::string::npos != line.find(" ERR "))
+            results.errors.fetch_add(1);
+        in_flight.erase(it);
+    }
+}
+
+/*!
+ * \brief Send the single request \a type and return the response.
+ */
+bool Request(const std::string& path, QueryType type, std::string& response)
+{
+    Query query;
+    query.type = type;
+
+    LineSocket socket;
+    return socket.Connect(path) && socket.Send(FormatQuery(query) + "\n") &&
+           socket.Receive(response);
+}
+
+int main(int argc, char** argv)
+{
+    LoadOptions options;
+
+    int flag;
+    while (-1 != (flag = getopt(argc, argv, "s:c:d:t:h"))) {
+        switch (flag) {
+        case 's': options.socket_path = optarg; break;
+        case 'c': options.connections = std::max(1, std::atoi(optarg)); break;
+        case 'd': options.depth = std::max(1, std::atoi(optarg)); break;
+        case 't': options.duration = std::atof(optarg); break;
+        default:
+            Usage();
+            return ('h' == flag) ? 0 : 1;
+        }
+    }
+
+    /* Ask the service which node labels exist. */
+    std::string   info;
+    std::uint64_t nodes    = 0;
+    std::uint64_t edges    = 0;
+    std::uint32_t max_node = 0;
+    if (!Request(options.socket_path, QueryType::kInfo, info) ||
+        (3 != std::sscanf(info.c_str(),
+                          "%*u OK %" SCNu64 " %" SCNu64 " %" SCNu32,
+                          &nodes, &edges, &max_node))) {
+        std::cerr << "Failed to query " << options.socket_path << ": "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    LoadResults       results;
+    Clock::time_point start    = Clock::now();
+    Clock::time_point deadline = start +
+        std::chrono::duration_cast<Clock::duration>(Seconds(options.duration));
+
+    std::vector<std::thread> clients;
+    for (std::size_t i = 0; i < options.connections; ++i)
+        clients.emplace_back(RunClient, std::cref(options), i, max_node,
+                             deadline, std::ref(results));
+    for (std::thread& client : clients)
+        client.join();
+    double elapsed = Seconds(Clock::now() - start).count();
+
+    if (results.failed.load()) {
+        std::cerr << "A connection to " << options.socket_path
+                  << " failed" << std::endl;
+        return 1;
+    }
+
+    std::uint64_t total = 0;
+    for (const LatencyHistogram& latency : results.latency)
+        total += latency.Count();
+
+    std::cout << "Nodes = " << nodes << ", Edges = " << edges << std::endl;
+    std::cout << "Connections = " << options.connections
+              << ", Depth = " << options.depth
+              << ", Duration = " << elapsed << " s" << std::endl;
+    std::cout << "Throughput = " << total / elapsed << " queries/s"
+              << std::endl;
+    for (QueryType type : {QueryType::kReach, QueryType::kSearch,
+                           QueryType::kPath}) {
+        const LatencyHistogram& latency =
+            results.latency[static_cast<std::size_t>(type)];
+        std::cout << QueryName(type) << ": Count = " << latency.Count()
+                  << ", p50 = " << latency.Percentile(0.5) / 1e3
+                  << " us, p99 = " << latency.Percentile(0.99) / 1e3
+                  << " us, p99.9 = " << latency.Percentile(0.999) / 1e3
+                  << " us, Max = " << latency.Max() / 1e3 << " us"
+                  << std::endl;
+    }
+    std::cout << "Errors = " << results.errors.load() << std::endl;
+
+    std::string stats;
+    if (Request(options.socket_path, QueryType::kStats, stats))
+        std::cout << "Service: " << stats << std::endl;
+
+    return 0;
+}
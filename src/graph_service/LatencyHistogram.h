@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/*!
+ * \class LatencyHistogram
+ * \brief The LatencyHistogram class records latencies from many threads.
+ *
+ * Values are counted in log-linear buckets: every power of two range is
+ * split into kSubBuckets equal buckets, so percentiles are reported with a
+ * relative error of at most 1 / kSubBuckets no matter the magnitude.
+ * Recording is a few relaxed atomic increments and never blocks.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr std::size_t kSubBits    = 3;
+    static constexpr std::size_t kSubBuckets = 1 << kSubBits;
+    static constexpr std::size_t kBuckets    = (64 - kSubBits + 1) *
+                                               kSubBuckets;
+
+    LatencyHistogram();
+    ~LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /*!
+     * \brief Record one latency of \a value units.
+     */
+    void
+    Record(std::uint64_t value);
+
+    /*!
+     * \brief Return the number of recorded latencies.
+     */
+    std::uint64_t
+    Count() const { return count_.load(std::memory_order_relaxed); }
+
+    /*!
+     * \brief Return the largest recorded latency.
+     */
+    std::uint64_t
+    Max() const { return max_.load(std::memory_order_relaxed); }
+
+    /*!
+     * \brief Return the mean recorded latency.
+     */
+    double
+    Mean() const;
+
+    /*!
+     * \brief Return an upper bound on the \a p quantile, 0 <= \a p <= 1.
+     */
+    std::uint64_t
+    Percentile(double p) const;
+
+private:
+    /*!
+     * \brief Return the bucket that \a value is counted in.
+     */
+    static std::size_t
+    BucketOf(std::uint64_t value);
+
+    /*!
+     * \brief Return the largest value counted in \a bucket.
+     */
+    static std::uint64_t
+    UpperBound(std::size_t bucket);
+
+    std::array<std::atomic<std::uint64_t>, kBuckets> counts_; /*!< Buckets. */
+    std::atomic<std::uint64_t> count_; /*!< Recorded latencies. */
+    std::atomic<std::uint64_t> sum_;   /*!< Sum of recorded latencies. */
+    std::atomic<std::uint64_t> max_;   /*!< Largest recorded latency. */
+}; // end LatencyHistogram
+
+inline
+LatencyHistogram::LatencyHistogram() :
+    count_(0),
+    sum_(0),
+    max_(0)
+{
+    for (std::atomic<std::uint64_t>& count : counts_)
+        count.store(0, std::memory_order_relaxed);
+}
+
+inline std::size_t
+LatencyHistogram::BucketOf(std::uint64_t value)
+{
+    if (value < kSubBuckets)
+        return value;
+
+    /* The top kSubBits + 1 bits of value select the bucket. */
+    std::size_t exponent = 63 - __builtin_clzll(value);
+    std::size_t sub      = (value >> (exponent - kSubBits)) & (kSubBuckets - 1);
+    return (exponent - kSubBits + 1) * kSubBuckets + sub;
+}
+
+inline std::uint64_t
+LatencyHistogram::UpperBound(std::size_t bucket)
+{
+    if (bucket < kSubBuckets)
+        return bucket;
+
+    std::size_t   exponent = bucket / kSubBuckets + kSubBits - 1;
+    std::uint64_t sub      = bucket % kSubBuckets;
+    std::uint64_t width    = std::uint64_t(1) << (exponent - kSubBits);
+    return ((kSubBuckets + sub) << (exponent - kSubBits)) + (width - 1);
+}
+
+inline void
+LatencyHistogram::Record(std::uint64_t value)
+{
+    counts_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    std::uint64_t max = max_.load(std::memory_order_relaxed);
+    while ((value > max) &&
+           !max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        ;
+}
+
+inline double
+LatencyHistogram::Mean() const
+{
+    std::uint64_t count = Count();
+    if (0 == count)
+        return 0.0;
+
+    return static_cast<double>(sum_.load(std::memory_order_relaxed)) / count;
+}
+
+inline std::uint64_t
+LatencyHistogram::Percentile(double p) const
+{
+    std::uint64_t count = Count();
+    if (0 == count)
+        return 0;
+
+    /* Rank of the requested value, counting from 1. */
+    auto rank = static_cast<std::uint64_t>(p * count + 0.5);
+    rank = std::min(std::max<std::uint64_t>(rank, 1), count);
+
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        seen += counts_[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(UpperBound(bucket), Max());
+    }
+    return Max();
+}
@@ -0,0 +1,630 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "GraphQuery.h"
+#include "LatencyHistogram.h"
+
+/*!
+ * \struct QueryServerOptions
+ * \brief The QueryServerOptions struct configures a QueryServer.
+ */
+struct QueryServerOptions
+{
+    std::string socket_path;          /*!< Unix socket to listen on. */
+    std::size_t num_threads   = 1;    /*!< Worker threads. */
+    std::size_t max_batch     = 256;  /*!< Queries handed out at once. */
+    std::size_t max_in_flight = 1024; /*!< Unanswered queries per client. */
+};
+
+/*!
+ * \class QueryServer
+ * \brief The QueryServer class serves QueryEngine queries over a Unix
+ *        socket.
+ *
+ * A single thread runs an epoll event loop that accepts clients, reads and
+ * parses request lines and writes responses, all without blocking. Graph
+ * queries are queued for a pool of worker threads, and each worker takes its
+ * share of the queue, at most max_batch queries, at a time. Under light
+ * load a query is picked up alone and answered right away, under heavy load
+ * queries pile up and are answered in large batches, which is where the
+ * batched search in QueryEngine::Execute() pays off. Workers hand responses
+ * back through a queue and wake the event loop with a pipe.
+ *
+ * Each client may pipeline up to max_in_flight queries. Beyond that, or
+ * while a client is not reading its responses, the server stops reading
+ * from it until it catches up.
+ */
+class QueryServer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /*!
+     * \brief Serve queries on \a engine, which must outlive the server.
+     */
+    QueryServer(const QueryEngine& engine, QueryServerOptions options);
+
+    ~QueryServer();
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    /*!
+     * \brief Create the listening socket.
+     *
+     * A stale socket left at the path by an earlier run is replaced, any
+     * other kind of file is not.
+     *
+     * \return \c false on failure, with errno set.
+     */
+    bool
+    Listen();
+
+    /*!
+     * \brief Serve clients until Stop() is called.
+     *
+     * \return \c false if the event loop failed, with errno set.
+     */
+    bool
+    Run();
+
+    /*!
+     * \brief Make Run() return.
+     *
+     * Stop() is async-signal-safe and may be called from a signal handler.
+     */
+    void
+    Stop();
+
+    /*!
+     * \brief Return a one line summary of the query latencies so far.
+     */
+    std::string
+    Stats() const;
+
+private:
+    /*! Largest accepted request line. */
+    static const std::size_t kMaxLineSize = 4096;
+
+    /*! Unsent response bytes at which a client is no longer read from. */
+    static const std::size_t kMaxOutput = 1 << 20;
+
+    /*! epoll tags of the listening socket and the wake pipe. */
+    static const std::uint64_t kListenTag = 0;
+    static const std::uint64_t kWakeTag   = 1;
+
+    /*!
+     * \struct Pending
+     * \brief A query waiting for a worker.
+     */
+    struct Pending
+    {
+        std::uint64_t     client;  /*!< Client that sent the query. */
+        Query             query;   /*!< The query. */
+        Clock::time_point arrival; /*!< When the query was parsed. */
+    };
+
+    /*!
+     * \struct Client
+     * \brief The state of one connected client.
+     */
+    struct Client
+    {
+        int         fd        = -1;    /*!< Client socket. */
+        std::string in;                /*!< Received, unparsed bytes. */
+        std::string out;               /*!< Responses not yet sent. */
+        std::size_t in_flight = 0;     /*!< Queries being answered. */
+        bool        eof       = false; /*!< Client closed its side. */
+    };
+
+    /*!
+     * \brief Accept every pending connection.
+     */
+    void
+    Accept();
+
+    /*!
+     * \brief Read from and parse requests of client \a tag.
+     */
+    void
+    Receive(std::uint64_t tag);
+
+    /*!
+     * \brief Parse complete request lines of \a client while it is under
+     *        its in-flight limit.
+     *
+     * \return \c false if \a client sent an oversized line.
+     */
+    bool
+    Parse(std::uint64_t tag, Client& client);
+
+    /*!
+     * \brief Send as much of the responses of client \a tag as possible and
+     *        update which events it waits for, closing it when done.
+     */
+    void
+    Service(std::uint64_t tag);
+
+    /*!
+     * \brief Disconnect client \a tag.
+     */
+    void
+    Close(std::uint64_t tag);
+
+    /*!
+     * \brief Hand the queries parsed during this loop iteration to the
+     *        workers.
+     */
+    void
+    Submit();
+
+    /*!
+     * \brief Route the responses computed by the workers to their clients.
+     */
+    void
+    Collect();
+
+    /*!
+     * \brief Main loop of a worker thread.
+     */
+    void
+    Work();
+
+    /*!
+     * \brief Return whether \a client may send more requests now.
+     */
+    bool
+    Readable(const Client& client) const
+    {
+        return !client.eof && (client.in_flight < options_.max_in_flight) &&
+               (client.in.size() < kMaxLineSize) &&
+               (client.out.size() < kMaxOutput);
+    }
+
+    using Response  = std::pair<std::uint64_t, std::string>;
+    using Latencies = std::array<LatencyHistogram, kNumGraphQueryTypes>;
+
+    const QueryEngine&                        engine_;      /*!< Queries. */
+    QueryServerOptions                        options_;     /*!< Settings. */
+    int                                       listen_fd_;   /*!< Listener. */
+    int                                       epoll_fd_;    /*!< Event loop. */
+    int                                       wake_fds_[2]; /*!< Wake pipe. */
+    std::atomic<bool>                         stop_;        /*!< Stopping. */
+    std::uint64_t                             next_tag_;    /*!< Next client. */
+    std::unordered_map<std::uint64_t, Client> clients_;     /*!< By tag. */
+    std::vector<Pending>                      incoming_;    /*!< Unqueued. */
+
+    std::mutex               queue_mutex_; /*!< Guards queue_, draining_. */
+    std::condition_variable  queue_ready_; /*!< Signals queued work. */
+    std::deque<Pending>      queue_;       /*!< Queries awaiting a worker. */
+    bool                     draining_;    /*!< Workers should exit. */
+    std::vector<std::thread> workers_;     /*!< Worker pool. */
+
+    std::mutex            done_mutex_; /*!< Guards done_. */
+    std::vector<Response> done_;       /*!< Responses by client tag. */
+
+    Latencies        latency_; /*!< Latency per query type, in ns. */
+    LatencyHistogram batches_; /*!< Queries per worker batch. */
+}; // end QueryServer
+
+inline
+QueryServer::QueryServer(const QueryEngine& engine,
+                         QueryServerOptions options) :
+    engine_(engine),
+    options_(std::move(options)),
+    listen_fd_(-1),
+    epoll_fd_(-1),
+    wake_fds_{-1, -1},
+    stop_(false),
+    next_tag_(kWakeTag + 1),
+    draining_(false)
+{
+    options_.num_threads   = std::max<std::size_t>(1, options_.num_threads);
+    options_.max_batch     = std::max<std::size_t>(1, options_.max_batch);
+    options_.max_in_flight = std::max<std::size_t>(1, options_.max_in_flight);
+}
+
+inline
+QueryServer::~QueryServer()
+{
+    while (!clients_.empty())
+        Close(clients_.begin()->first);
+
+    for (int fd : {listen_fd_, epoll_fd_, wake_fds_[0], wake_fds_[1]}) {
+        if (fd >= 0)
+            close(fd);
+    }
+    if (listen_fd_ >= 0)
+        unlink(options_.socket_path.c_str());
+}
+
+inline bool
+QueryServer::Listen()
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (options_.socket_path.size() >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    std::strcpy(address.sun_path, options_.socket_path.c_str());
+
+    struct stat info;
+    if ((0 == stat(address.sun_path, &info)) && S_ISSOCK(info.st_mode))
+        unlink(address.sun_path);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        0);
+    if ((listen_fd_ < 0) ||
+        (0 != bind(listen_fd_, reinterpret_cast<sockaddr*>(&address),
+                   sizeof(address))) ||
+        (0 != listen(listen_fd_, SOMAXCONN)))
+        return false;
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if ((epoll_fd_ < 0) || (0 != pipe2(wake_fds_, O_NONBLOCK | O_CLOEXEC)))
+        return false;
+
+    epoll_event event;
+    event.events   = EPOLLIN;
+    event.data.u64 = kListenTag;
+    if (0 != epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event))
+        return false;
+    event.data.u64 = kWakeTag;
+    return (0 == epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fds_[0], &event));
+}
+
+inline void
+QueryServer::Stop()
+{
+    stop_.store(true);
+
+    char byte = 0;
+    if (write(wake_fds_[1], &byte, 1) < 0) {
+        /* The pipe is full, so the loop will wake up anyway. */
+    }
+}
+
+inline bool
+QueryServer::Run()
+{
+    for (std::size_t i = 0; i < options_.num_threads; ++i)
+        workers_.emplace_back(&QueryServer::Work, this);
+
+    bool ok = true;
+    std::array<epoll_event, 256> events;
+    while (!stop_.load()) {
+        int count = epoll_wait(epoll_fd_, events.data(),
+                               static_cast<int>(events.size()), -1);
+        if (count < 0) {
+            if (EINTR == errno)
+                continue;
+            ok = false;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            std::uint64_t tag = events[i].data.u64;
+            if (kListenTag == tag) {
+                Accept();
+            } else if (kWakeTag == tag) {
+                char buffer[256];
+                while (read(wake_fds_[0], buffer, sizeof(buffer)) > 0)
+                    ;
+                Collect();
+            } else if (clients_.count(tag)) {
+                /* A hung up client can no longer be answered. */
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    Close(tag);
+                    continue;
+                }
+                if (events[i].events & EPOLLIN)
+                    Receive(tag);
+                if (clients_.count(tag))
+                    Service(tag);
+            }
+        }
+        Submit();
+    }
+
+    int error = errno;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        draining_ = true;
+    }
+    queue_ready_.notify_all();
+    for (std::thread& worker : workers_)
+        worker.join();
+    workers_.clear();
+
+    errno = error;
+    return ok;
+}
+
+inline void
+QueryServer::Accept()
+{
+    for (;;) {
+        int fd = accept4(listen_fd_, nullptr, nullptr,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        std::uint64_t tag = next_tag_++;
+        epoll_event   event;
+        event.events   = EPOLLIN;
+        event.data.u64 = tag;
+        if (0 != epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event)) {
+            close(fd);
+            continue;
+        }
+        clients_[tag].fd = fd;
+    }
+}
+
+inline void
+QueryServer::Receive(std::uint64_t tag)
+{
+    Client& client = clients_[tag];
+
+    char buffer[1 << 16];
+    while (Readable(client)) {
+        ssize_t size = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (size > 0) {
+            client.in.append(buffer, size);
+            if (!Parse(tag, client)) {
+                Close(tag);
+                return;
+            }
+        } else if ((0 == size) ||
+                   ((EAGAIN != errno) && (EWOULDBLOCK != errno) &&
+                    (EINTR != errno))) {
+            client.eof = true;
+        } else if (EINTR != errno) {
+            break;
+        }
+    }
+}
+
+inline bool
+QueryServer::Parse(std::uint64_t tag, Client& client)
+{
+    std::size_t start = 0;
+    while (client.in_flight < options_.max_in_flight) {
+        std::size_t end = client.in.find('\n', start);
+        if (std::string::npos == end)
+            break;
+
+        std::string line = client.in.substr(start, end - start);
+        start = end + 1;
+        if (!line.empty() && ('\r' == line.back()))
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        Query query;
+        if (!ParseQuery(line, query)) {
+            client.out += std::to_string(query.tag) +
+                          " ERR malformed request\n";
+        } else if (QueryType::kInfo == query.type) {
+            client.out += std::to_string(query.tag) + " OK " +
+                          std::to_string(engine_.Size()) + " " +
+                          std::to_string(engine_.EdgeCount()) + " " +
+                          std::to_string(engine_.MaxNode()) + "\n";
+        } else if (QueryType::kStats == query.type) {
+            client.out += std::to_string(query.tag) + " OK " + Stats() + "\n";
+        } else {
+            client.in_flight++;
+            incoming_.push_back({tag, query, Clock::now()});
+        }
+    }
+    client.in.erase(0, start);
+
+    /* Lines held back by the in-flight limit are fine, a partial line that
+       does not fit is not. */
+    return ((client.in.size() < kMaxLineSize) ||
+            (std::string::npos != client.in.find('\n')));
+}
+
+inline void
+QueryServer::Service(std::uint64_t tag)
+{
+    Client& client = clients_[tag];
+    while (!client.out.empty()) {
+        ssize_t size = send(client.fd, client.out.data(), client.out.size(),
+                            MSG_NOSIGNAL);
+        if (size > 0) {
+            client.out.erase(0, size);
+        } else if ((size < 0) && (EINTR == errno)) {
+            continue;
+        } else if ((size < 0) &&
+                   ((EAGAIN == errno) || (EWOULDBLOCK == errno))) {
+            break;
+        } else {
+            Close(tag);
+            return;
+        }
+    }
+
+    /* A client that hung up is closed once it has its answers. */
+    if (client.eof && (0 == client.in_flight) && client.out.empty()) {
+        Close(tag);
+        return;
+    }
+
+    epoll_event event;
+    event.events = 0;
+    if (Readable(client))
+        event.events |= EPOLLIN;
+    if (!client.out.empty())
+        event.events |= EPOLLOUT;
+    event.data.u64 = tag;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client.fd, &event);
+}
+
+inline void
+QueryServer::Close(std::uint64_t tag)
+{
+    auto it = clients_.find(tag);
+    if (it == clients_.end())
+        return;
+
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    close(it->second.fd);
+    clients_.erase(it);
+}
+
+inline void
+QueryServer::Submit()
+{
+    if (incoming_.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        std::move(incoming_.begin(), incoming_.end(),
+                  std::back_inserter(queue_));
+    }
+    incoming_.clear();
+    queue_ready_.notify_all();
+}
+
+inline void
+QueryServer::Collect()
+{
+    std::vector<Response> done;
+    {
+        std::lock_guard<std::mutex> lock(done_mutex_);
+        done.swap(done_);
+    }
+
+    /* Responses to clients that have gone away are dropped. */
+    std::vector<std::uint64_t> touched;
+    for (auto& response : done) {
+        auto it = clients_.find(response.first);
+        if (it == clients_.end())
+            continue;
+
+        it->second.out += response.second;
+        it->second.out += '\n';
+        it->second.in_flight--;
+        touched.push_back(response.first);
+    }
+
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (std::uint64_t tag : touched) {
+        /* Requests held back by the in-flight limit can go out now. */
+        if (!Parse(tag, clients_[tag])) {
+            Close(tag);
+            continue;
+        }
+        Service(tag);
+    }
+}
+
+inline void
+QueryServer::Work()
+{
+    QueryEngine::Scratch scratch;
+    std::vector<Pending> batch;
+    std::vector<Query>   queries;
+    for (;;) {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_ready_.wait(lock, [this]
+                { return draining_ || !queue_.empty(); });
+            if (draining_)
+                return;
+
+            /* Take a fair share of the queue so that a burst is spread
+               over all workers instead of landing on the first one. */
+            std::size_t share = (queue_.size() + options_.num_threads - 1) /
+                                options_.num_threads;
+            std::size_t size  = std::min(share, options_.max_batch);
+            std::move(queue_.begin(), queue_.begin() + size,
+                      std::back_inserter(batch));
+            queue_.erase(queue_.begin(), queue_.begin() + size);
+        }
+
+        queries.clear();
+        for (const Pending& pending : batch)
+            queries.push_back(pending.query);
+        std::vector<std::string> responses = engine_.Execute(queries, scratch);
+
+        Clock::time_point now = Clock::now();
+        for (const Pending& pending : batch) {
+            auto type = static_cast<std::size_t>(pending.query.type);
+            latency_[type].Record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    now - pending.arrival).count());
+        }
+        batches_.Record(batch.size());
+
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(done_mutex_);
+            wake = done_.empty();
+            for (std::size_t i = 0; i < batch.size(); ++i)
+                done_.emplace_back(batch[i].client, std::move(responses[i]));
+        }
+
+        /* One byte per batch of responses is enough to wake the loop. */
+        char byte = 0;
+        if (wake && (write(wake_fds_[1], &byte, 1) < 0)) {
+            /* The pipe is full, so the loop will wake up anyway. */
+        }
+    }
+}
+
+inline std::string
+QueryServer::Stats() const
+{
+    static const QueryType kTypes[] = {
+        QueryType::kReach, QueryType::kSearch, QueryType::kPath,
+    };
+
+    std::ostringstream stats;
+    stats << std::fixed << std::setprecision(1);
+    for (QueryType type : kTypes) {
+        const LatencyHistogram& latency =
+            latency_[static_cast<std::size_t>(type)];
+        stats << QueryName(type) << " n=" << latency.Count()
+              << " mean=" << latency.Mean() / 1e3
+              << "us p50=" << latency.Percentile(0.5) / 1e3
+              << "us p99=" << latency.Percentile(0.99) / 1e3
+              << "us p999=" << latency.Percentile(0.999) / 1e3
+              << "us max=" << latency.Max() / 1e3 << "us; ";
+    }
+    stats << "BATCH n=" << batches_.Count() << " mean=" << batches_.Mean()
+          << " max=" << batches_.Max();
+
+    return stats.str();
+}